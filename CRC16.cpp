@@ -14,7 +14,7 @@ typedef uint16 CRC;
 #define TOPBIT   (1 << (WIDTH-1))
 #define POLYNOMIAL 0x1021
 
-#ifdef WIN32
+#if defined(WIN32) || defined(__unix__) || defined(__APPLE__)
 #define rom	 // needed to make some code reusuable in the PIC
 #endif
 
@@ -0,0 +1,69 @@
+// HypnoCOMM - serial communications for the HypnoGadgets
+// www.HypnoCube.com, www.HypnoSquare.com
+// packing an RGB canvas to and from the gadget frame format
+#include "Canvas.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define CANVAS_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace HypnoGadget {
+
+// Each output byte is the high nibbles of a pair of canvas bytes, since
+// the canvas holds channels in wire order.
+void Canvas::Pack(uint8 * frame) const
+	{
+#ifdef CANVAS_SSE2
+	// as 16 bit lanes, pair (a,b) is a | b<<8, want (a & 0xF0) | (b >> 4)
+	const __m128i mask = _mm_set1_epi16(0x00F0);
+	for (int pos = 0; pos < CanvasRGBBytes; pos += 32)
+		{
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb_+pos));
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb_+pos+16));
+		a = _mm_or_si128(_mm_and_si128(a,mask),_mm_srli_epi16(a,12));
+		b = _mm_or_si128(_mm_and_si128(b,mask),_mm_srli_epi16(b,12));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(frame+pos/2),_mm_packus_epi16(a,b));
+		}
+#else
+	for (int pos = 0; pos < CanvasFrameSize; ++pos)
+		frame[pos] = (rgb_[2*pos]&0xF0) | (rgb_[2*pos+1]>>4);
+#endif
+	} // Pack
+
+// Each frame byte becomes a pair of canvas bytes, with each nibble
+// copied to both halves of its byte.
+void Canvas::Unpack(const uint8 * frame)
+	{
+#ifdef CANVAS_SSE2
+	// as 16 bit lanes, frame byte f becomes (f & 0xF0) | (f & 0x0F)<<12,
+	// then each nibble is copied down to fill its byte
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i high = _mm_set1_epi16(0x00F0);
+	const __m128i low  = _mm_set1_epi16(0x000F);
+	const __m128i fill = _mm_set1_epi16(0x0F0F);
+	for (int pos = 0; pos < CanvasFrameSize; pos += 16)
+		{
+		__m128i f = _mm_loadu_si128(reinterpret_cast<const __m128i*>(frame+pos));
+		__m128i a = _mm_unpacklo_epi8(f,zero);
+		__m128i b = _mm_unpackhi_epi8(f,zero);
+		a = _mm_or_si128(_mm_and_si128(a,high),_mm_slli_epi16(_mm_and_si128(a,low),12));
+		b = _mm_or_si128(_mm_and_si128(b,high),_mm_slli_epi16(_mm_and_si128(b,low),12));
+		a = _mm_or_si128(a,_mm_and_si128(_mm_srli_epi16(a,4),fill));
+		b = _mm_or_si128(b,_mm_and_si128(_mm_srli_epi16(b,4),fill));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(rgb_+2*pos),a);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(rgb_+2*pos+16),b);
+		}
+#else
+	for (int pos = 0; pos < CanvasFrameSize; ++pos)
+		{
+		uint8 byte = frame[pos];
+		rgb_[2*pos]   = (byte&0xF0) | (byte>>4);
+		rgb_[2*pos+1] = (byte<<4) | (byte&0x0F);
+		}
+#endif
+	} // Unpack
+
+}; // namespace HypnoGadget
+
+// end - Canvas.cpp
@@ -0,0 +1,83 @@
+// HypnoCOMM - serial communications for the HypnoGadgets
+// www.HypnoCube.com, www.HypnoSquare.com
+// header for an unpacked RGB canvas for the HypnoCube
+#ifndef CANVAS_H
+#define CANVAS_H
+
+#include "defines.h"
+#include "VoxelTables.h"
+#include <cassert>
+#include <cstring>
+
+namespace HypnoGadget {
+
+enum {
+	CanvasVoxels    = 64, // 4x4x4 cube
+	CanvasRGBBytes  = CanvasVoxels*3, // unpacked bytes, RGB888
+	CanvasFrameSize = CanvasVoxels*3/2 // packed bytes sent to the gadget
+	};
+
+/* 64 voxels of RGB888 color, one byte per channel, for drawing the cube.
+   The gadget wants each channel as 4 bits, packed so each three bytes hold
+   two voxels as R1G1 B1R2 G2B2. The canvas stores voxels in that same order,
+   so packing is a straight pass taking the high nibble of each byte pair, and
+   drawing is a plain indexed store with no masking.
+*/
+class Canvas
+	{
+public:
+	Canvas(void)
+		{
+		Clear();
+		}
+
+	// set all voxels to black
+	void Clear(void)
+		{
+		memset(rgb_,0,sizeof(rgb_));
+		}
+
+	// index of voxel i,j,k in 0-3 in wire order. j runs backwards
+	// to get the right hand coord system used in cube
+	static constexpr int Index(int i, int j, int k)
+		{
+		return VoxelIndex(i,j,k);
+		}
+
+	// set voxel i,j,k in 0-3 to the color
+	void Set(int i, int j, int k, uint8 red, uint8 green, uint8 blue)
+		{
+		assert((0 <= i) && (i < 4) && (0 <= j) && (j < 4) && (0 <= k) && (k < 4));
+		SetIndex(Index(i,j,k),red,green,blue);
+		}
+
+	// set voxel by wire order index 0-63
+	void SetIndex(int index, uint8 red, uint8 green, uint8 blue)
+		{
+		uint8 * p = rgb_ + 3*index;
+		p[0] = red;
+		p[1] = green;
+		p[2] = blue;
+		}
+
+	// RGB bytes of voxel by wire order index 0-63
+	const uint8 * GetIndex(int index) const
+		{
+		return rgb_ + 3*index;
+		}
+
+	// pack to the CanvasFrameSize byte frame format for SetFrame
+	void Pack(uint8 * frame) const;
+
+	// unpack a frame, such as one read back with GetFrame.
+	// 4 bit channels are widened so 15 becomes 255
+	void Unpack(const uint8 * frame);
+
+private:
+	uint8 rgb_[CanvasRGBBytes]; // R,G,B per voxel in wire order
+	}; // class Canvas
+
+}; // namespace HypnoGadget
+
+#endif // CANVAS_H
+// end - Canvas.h
@@ -0,0 +1,120 @@
+// cache of rendered clock frames for the HypnoDemo
+#include "ClockCache.h"
+#include <cstring>
+#include <string>
+
+using namespace std;
+
+namespace HypnoGadget {
+
+ClockFrameCache::ClockFrameCache(uint32 size) : memoSize_(size)
+	{
+	tableType_ = 0;
+	tableRate_ = 0;
+	hits_ = misses_ = 0;
+	} // ClockFrameCache
+
+// pack a time state into a memo key, hours folded to 0-11
+// layout is type:7 hour:4 minute:6 second:6 update:5 bits
+uint32 ClockFrameCache::Key(char clockType, int hour, int minute, int second, int updateCountThisSec)
+	{
+	uint32 key = static_cast<uint8>(clockType) & 127;
+	key = (key << 4) | (hour % 12);
+	key = (key << 6) | (minute & 63);
+	key = (key << 6) | (second & 63);
+	key = (key << 5) | (updateCountThisSec & 31);
+	return key;
+	} // Key
+
+// copy the frame for this state into image, return true if found
+bool ClockFrameCache::Lookup(char clockType, int hour, int minute, int second,
+		int updateCountThisSec, uint8 * image)
+	{
+	if ((tableType_ == clockType) && (updateCountThisSec < tableRate_))
+		{ // precomputed table is one lookup
+		uint32 state = ((hour%12)*60 + minute)*60 + second;
+		uint32 frame = tableIndex_[state*tableRate_ + updateCountThisSec];
+		memcpy(image,&tableFrames_[frame*ClockFrameSize],ClockFrameSize);
+		++hits_;
+		return true;
+		}
+
+	unordered_map<uint32,Frame>::const_iterator iter =
+		memo_.find(Key(clockType,hour,minute,second,updateCountThisSec));
+	if (memo_.end() == iter)
+		{
+		++misses_;
+		return false;
+		}
+	memcpy(image,iter->second.data_,ClockFrameSize);
+	++hits_;
+	return true;
+	} // Lookup
+
+// remember the frame drawn for this state
+void ClockFrameCache::Store(char clockType, int hour, int minute, int second,
+		int updateCountThisSec, const uint8 * image)
+	{
+	if ((0 != memoSize_) && (memo_.size() >= memoSize_))
+		memo_.clear(); // full - start over rather than track ages
+	Frame & frame = memo_[Key(clockType,hour,minute,second,updateCountThisSec)];
+	memcpy(frame.data_,image,ClockFrameSize);
+	} // Store
+
+// render every state of 12 hours for the clock type at the given
+// updates per second into the compact table, replacing any old table
+void ClockFrameCache::Precompute(char clockType, int updatesPerSec, ClockRenderFunc render)
+	{
+	tableType_ = 0; // table invalid while building
+	tableIndex_.clear();
+	tableFrames_.clear();
+	if (updatesPerSec <= 0)
+		return;
+
+	// most clocks repeat frames often, so store each distinct frame once
+	unordered_map<string,uint32> distinct;
+	uint8 image[ClockFrameSize];
+
+	tableIndex_.resize(12*60*60*updatesPerSec);
+	uint32 pos = 0;
+	for (int hour = 0; hour < 12; ++hour)
+		for (int minute = 0; minute < 60; ++minute)
+			for (int second = 0; second < 60; ++second)
+				for (int update = 0; update < updatesPerSec; ++update)
+					{
+					memset(image,0,sizeof(image));
+					render(clockType,hour,minute,second,update,image);
+					string bytes(reinterpret_cast<const char*>(image),sizeof(image));
+					unordered_map<string,uint32>::iterator iter = distinct.find(bytes);
+					if (distinct.end() == iter)
+						{ // new frame, append it
+						uint32 frame = static_cast<uint32>(distinct.size());
+						iter = distinct.insert(make_pair(bytes,frame)).first;
+						tableFrames_.insert(tableFrames_.end(),image,image+sizeof(image));
+						}
+					tableIndex_[pos++] = iter->second;
+					}
+
+	tableRate_ = updatesPerSec;
+	tableType_ = clockType;
+	} // Precompute
+
+// clear the memo and the precomputed table
+void ClockFrameCache::Clear(void)
+	{
+	memo_.clear();
+	tableType_ = 0;
+	tableRate_ = 0;
+	tableIndex_.clear();
+	tableFrames_.clear();
+	} // Clear
+
+// bytes used by the precomputed table
+uint32 ClockFrameCache::TableBytes(void) const
+	{
+	return static_cast<uint32>(tableIndex_.size()*sizeof(uint32) + tableFrames_.size());
+	} // TableBytes
+
+}; // namespace HypnoGadget
+
+// end - ClockCache.cpp
@@ -0,0 +1,83 @@
+// header for a cache of rendered clock frames for the HypnoDemo
+#ifndef CLOCKCACHE_H
+#define CLOCKCACHE_H
+
+#include "defines.h"
+#include <vector>
+#include <unordered_map>
+
+namespace HypnoGadget {
+
+enum {
+	ClockFrameSize = 96 // bytes in one packed 4x4x4 frame
+	};
+
+// draws one clock frame into image, given the clock type and time
+// must depend on nothing but its parameters, so frames can be cached
+typedef void (*ClockRenderFunc)(char clockType, int hour, int minute, int second,
+	int updateCountThisSec, uint8 * image);
+
+/* A clock frame is fully determined by the clock type, hour, minute, second, and
+   the update count within the second, so finished frames can be remembered and
+   reused instead of redrawn. All the clocks show the hour with a 12 position hand,
+   so hours are folded to 0-11 to halve the number of states.
+
+   Frames are found two ways:
+   1. A memo of every state seen so far, filled by Store.
+   2. An optional table precomputed for one clock type over a whole 12 hours,
+      holding each distinct frame once and a 32 bit index per time state, so
+      steady state rendering is a single lookup.
+*/
+class ClockFrameCache
+	{
+public:
+	// size is the max number of memo frames kept (0 for no limit)
+	ClockFrameCache(uint32 size = 65536);
+
+	// copy the frame for this state into image, return true if found
+	bool Lookup(char clockType, int hour, int minute, int second,
+		int updateCountThisSec, uint8 * image);
+
+	// remember the frame drawn for this state
+	void Store(char clockType, int hour, int minute, int second,
+		int updateCountThisSec, const uint8 * image);
+
+	// render every state of 12 hours for the clock type at the given
+	// updates per second into the compact table, replacing any old table
+	void Precompute(char clockType, int updatesPerSec, ClockRenderFunc render);
+
+	// clear the memo and the precomputed table
+	void Clear(void);
+
+	// statistics
+	uint32 Hits(void) const    { return hits_; }
+	uint32 Misses(void) const  { return misses_; }
+	uint32 MemoCount(void) const { return static_cast<uint32>(memo_.size()); }
+	uint32 TableFrames(void) const { return static_cast<uint32>(tableFrames_.size()/ClockFrameSize); }
+	uint32 TableBytes(void) const;
+
+private:
+	struct Frame
+		{
+		uint8 data_[ClockFrameSize];
+		};
+
+	// pack a time state into a memo key, hours folded to 0-11
+	static uint32 Key(char clockType, int hour, int minute, int second, int updateCountThisSec);
+
+	std::unordered_map<uint32,Frame> memo_; // every state seen so far
+	uint32 memoSize_;                       // max entries in memo_, 0 for no limit
+
+	// precomputed table for a single clock type
+	char   tableType_;          // clock type in table, 0 if none
+	int    tableRate_;          // updates per second the table was built for
+	std::vector<uint32> tableIndex_; // frame number for each time state
+	std::vector<uint8>  tableFrames_; // distinct frames, packed back to back
+
+	uint32 hits_, misses_;
+	}; // class ClockFrameCache
+
+}; // namespace HypnoGadget
+
+#endif // CLOCKCACHE_H
+// end - ClockCache.h
@@ -0,0 +1,728 @@
+// HypnoCOMM - serial communications for the HypnoGadgets
+// www.HypnoCube.com, www.HypnoSquare.com
+// the clock faces for the HypnoCube, as layers of hands
+#include "ClockRender.h"
+#include "VoxelTables.h"
+
+namespace HypnoGadget {
+
+namespace {
+
+struct Color
+	{
+	uint8 red_, green_, blue_;
+	};
+
+void SetColor(LayerCanvas & canvas, int i, int j, int k, const Color & color)
+	{
+	canvas.Set(i,j,k,color.red_,color.green_,color.blue_);
+	}
+
+void AddColor(BitboardCanvas & canvas, uint64 lit, const Color & color)
+	{
+	canvas.Add(lit,color.red_,color.green_,color.blue_);
+	}
+
+// bits of z-column i,j from plane low up to, not including, plane high
+uint64 ColumnBits(int i, int j, int low, int high)
+	{
+	if (high <= low)
+		return 0;
+	const uint64 column = 0x0001000100010001ULL << Canvas::Index(i,j,0);
+	return column & (~0ULL << 16*low) & (~0ULL >> 16*(4-high));
+	} // ColumnBits
+
+// 12 position hand for a 24 hour, or 0-11 count
+int HourHand(int hour)
+	{
+	return hour % 12;
+	}
+
+/***************************** TestClock ********************************/
+
+// fill the cube with a color gradient along each axis
+void DrawGradient(const ClockTime &, const void *, LayerCanvas & canvas)
+	{
+	for (int ii = 0; ii <= 63; ++ii)
+		{
+		int x = ii/16; // convert ii 0-63 to x,y,z in [0,3]x[0,3]x[0,3]
+		int y = (ii/4)&3;
+		int z = ii&3;
+		canvas.Set(x,y,z,x*x*28,y*y*28,z*z*28);
+		}
+	} // DrawGradient
+
+/************************* Early and Paddle Clocks ************************/
+/* "Diagonal" clocks. The top of the cube has 12 leds around its edge, so
+   turning the square 45 degrees into a diamond maps them one-to-one onto
+   the numerals of an analog clock, with 12 at the back left corner when the
+   red power button is towards you. Hands are the z-columns under those leds.
+*/
+
+const Color green  = {0,255,0};
+const Color white  = {255,255,255};
+const Color red    = {255,0,0};
+const Color yellow = {255,255,0};
+const Color blue   = {0,0,255};
+
+// hour hand is the edge z-column and the middle one next to it
+// param is the number of planes tall, from the bottom
+void DrawDiagonalHour(const ClockTime & time, const void * param, LayerCanvas & canvas)
+	{
+	const DiagonalHand & hand = DiagonalHands[HourHand(time.hour_)];
+	int height = *static_cast<const int*>(param);
+	for (int z = 0; z < height; ++z)
+		{
+		SetColor(canvas,hand.col_,hand.row_,z,green);
+		SetColor(canvas,hand.mcol_,hand.mrow_,z,green);
+		}
+	} // DrawDiagonalHour
+
+// minute hand is a white z-column, turning red from the top down as
+// the minutes between numerals pass
+void DrawEarlyMinute(const ClockTime & time, const void *, LayerCanvas & canvas)
+	{
+	const DiagonalHand & hand = DiagonalHands[time.minute_/5];
+	for (int z = 0; z < 4; ++z)
+		SetColor(canvas,hand.col_,hand.row_,z,white);
+	for (int z = 4-time.minute_%5; z < 4; ++z)
+		SetColor(canvas,hand.col_,hand.row_,z,red);
+	} // DrawEarlyMinute
+
+// minute hand is a white paddle on the top two planes of the edge and
+// middle z-columns, turning red one led at a time as the minutes pass
+void DrawPaddleMinute(const ClockTime & time, const void *, LayerCanvas & canvas)
+	{
+	const DiagonalHand & hand = DiagonalHands[time.minute_/5];
+	// leds in the order they turn red, as i,j,k
+	const int leds[4][3] = {
+		{hand.col_,hand.row_,3},   {hand.mcol_,hand.mrow_,3},
+		{hand.mcol_,hand.mrow_,2}, {hand.col_,hand.row_,2}
+		};
+	for (int led = 0; led < 4; ++led)
+		SetColor(canvas,leds[led][0],leds[led][1],leds[led][2],
+			(led < time.minute_%5) ? red : white);
+	} // DrawPaddleMinute
+
+// second hand is a yellow z-column, turning blue from the top down as
+// the seconds between numerals pass
+void DrawDiagonalSecond(const ClockTime & time, const void *, LayerCanvas & canvas)
+	{
+	const DiagonalHand & hand = DiagonalHands[time.second_/5];
+	for (int z = 0; z < 4; ++z)
+		SetColor(canvas,hand.col_,hand.row_,z,yellow);
+	for (int z = 4-time.second_%5; z < 4; ++z)
+		SetColor(canvas,hand.col_,hand.row_,z,blue);
+	} // DrawDiagonalSecond
+
+// each 1/12 second, advance to the next led along the edge of the bottom plane
+void DrawDiagonalUpdate(const ClockTime & time, const void *, LayerCanvas & canvas)
+	{
+	const DiagonalHand & hand = DiagonalHands[HourHand(time.update_)];
+	SetColor(canvas,hand.col_,hand.row_,0,white);
+	} // DrawDiagonalUpdate
+
+// the diagonal hands as bitboards, drawing the same voxels
+void DrawDiagonalHourBits(const ClockTime & time, const void * param, BitboardCanvas & canvas)
+	{
+	const DiagonalHand & hand = DiagonalHands[HourHand(time.hour_)];
+	int height = *static_cast<const int*>(param);
+	AddColor(canvas,ColumnBits(hand.col_,hand.row_,0,height) | ColumnBits(hand.mcol_,hand.mrow_,0,height),green);
+	} // DrawDiagonalHourBits
+
+void DrawEarlyMinuteBits(const ClockTime & time, const void *, BitboardCanvas & canvas)
+	{
+	const DiagonalHand & hand = DiagonalHands[time.minute_/5];
+	AddColor(canvas,ColumnBits(hand.col_,hand.row_,0,4),white);
+	AddColor(canvas,ColumnBits(hand.col_,hand.row_,4-time.minute_%5,4),red);
+	} // DrawEarlyMinuteBits
+
+// paddle leds in the order they turn red
+void DrawPaddleMinuteBits(const ClockTime & time, const void *, BitboardCanvas & canvas)
+	{
+	const DiagonalHand & hand = DiagonalHands[time.minute_/5];
+	const uint64 leds[4] = {
+		BitboardCanvas::Bit(hand.col_,hand.row_,3),   BitboardCanvas::Bit(hand.mcol_,hand.mrow_,3),
+		BitboardCanvas::Bit(hand.mcol_,hand.mrow_,2), BitboardCanvas::Bit(hand.col_,hand.row_,2)
+		};
+	uint64 progress = 0;
+	for (int led = 0; led < time.minute_%5; ++led)
+		progress |= leds[led];
+	AddColor(canvas,leds[0] | leds[1] | leds[2] | leds[3],white);
+	AddColor(canvas,progress,red);
+	} // DrawPaddleMinuteBits
+
+void DrawDiagonalSecondBits(const ClockTime & time, const void *, BitboardCanvas & canvas)
+	{
+	const DiagonalHand & hand = DiagonalHands[time.second_/5];
+	AddColor(canvas,ColumnBits(hand.col_,hand.row_,0,4),yellow);
+	AddColor(canvas,ColumnBits(hand.col_,hand.row_,4-time.second_%5,4),blue);
+	} // DrawDiagonalSecondBits
+
+void DrawDiagonalUpdateBits(const ClockTime & time, const void *, BitboardCanvas & canvas)
+	{
+	const DiagonalHand & hand = DiagonalHands[HourHand(time.update_)];
+	AddColor(canvas,BitboardCanvas::Bit(hand.col_,hand.row_,0),white);
+	} // DrawDiagonalUpdateBits
+
+const int earlyHeight  = 4;
+const int paddleHeight = 2;
+
+const ClockLayer EarlyLayers[] = {
+	{ClockHour,   DrawDiagonalHour,   &earlyHeight},
+	{ClockMinute, DrawEarlyMinute,    0},
+	{ClockSecond, DrawDiagonalSecond, 0},
+	{ClockUpdate, DrawDiagonalUpdate, 0}
+	};
+
+const ClockLayer PaddleLayers[] = {
+	{ClockHour,   DrawDiagonalHour,   &paddleHeight},
+	{ClockMinute, DrawPaddleMinute,   0},
+	{ClockSecond, DrawDiagonalSecond, 0},
+	{ClockUpdate, DrawDiagonalUpdate, 0}
+	};
+
+const BitClockLayer EarlyBits[] = {
+	{DrawDiagonalHourBits,   &earlyHeight},
+	{DrawEarlyMinuteBits,    0},
+	{DrawDiagonalSecondBits, 0},
+	{DrawDiagonalUpdateBits, 0}
+	};
+
+const BitClockLayer PaddleBits[] = {
+	{DrawDiagonalHourBits,   &paddleHeight},
+	{DrawPaddleMinuteBits,   0},
+	{DrawDiagonalSecondBits, 0},
+	{DrawDiagonalUpdateBits, 0}
+	};
+
+/***************************** Hands Clocks *******************************/
+/* The 'front' of the cube is the right side when viewed from the red button
+   side. With the front facing you, the back row plane shows the hour hand,
+   the next the minute hand, then the second hand, and the front plane shows
+   the current 5 second period and the 1/12 second indicator. Each hand is 4
+   leds in its plane, changing color one led at a time between numerals.
+*/
+
+// colors of one hand
+struct HandStyle
+	{
+	Color base_;     // the whole hand
+	Color progress_; // leds counting between numerals
+	Color blink_;    // progress color on even updates, when blinks_
+	bool blinks_;
+	};
+
+// colors of a whole hands clock
+struct HandsStyle
+	{
+	Color square_; // 5 second squares
+	HandStyle second_, minute_, hour_;
+	};
+
+// the front plane divides into 5 4-led squares, one in each corner and the
+// center, lit in turn to show the second within the 5 second period.
+// given as i,k pairs in the front plane
+const uint8 FiveSecondSquares[5][4][2] = {
+	{{1,1}, {1,2}, {2,1}, {2,2}},
+	{{3,3}, {3,2}, {2,3}, {2,2}},
+	{{0,3}, {1,3}, {0,2}, {1,2}},
+	{{1,1}, {1,0}, {0,1}, {0,0}},
+	{{3,1}, {3,0}, {2,1}, {2,0}}
+	};
+
+void DrawFiveSecondSquare(const ClockTime & time, const void * param, LayerCanvas & canvas)
+	{
+	const HandsStyle & style = *static_cast<const HandsStyle*>(param);
+	const uint8 (&square)[4][2] = FiveSecondSquares[time.second_%5];
+	for (int led = 0; led < 4; ++led)
+		SetColor(canvas,square[led][0],3,square[led][1],style.square_);
+	} // DrawFiveSecondSquare
+
+// draw hand position index in row plane j, with count 0-4 leds in the
+// progress color, counting from the last led
+void DrawPlaneHand(LayerCanvas & canvas, int j, int index, int count,
+		const HandStyle & style, int update)
+	{
+	const PlaneHand & hand = PlaneHands[index];
+	const Color & progress = ((true == style.blinks_) && (0 == update%2)) ?
+		style.blink_ : style.progress_;
+	for (int led = 0; led < 4; ++led)
+		SetColor(canvas,hand.led_[led].col_,j,hand.led_[led].z_,style.base_);
+	for (int led = 4-count; led < 4; ++led)
+		SetColor(canvas,hand.led_[led].col_,j,hand.led_[led].z_,progress);
+	} // DrawPlaneHand
+
+void DrawPlaneSecond(const ClockTime & time, const void * param, LayerCanvas & canvas)
+	{
+	const HandsStyle & style = *static_cast<const HandsStyle*>(param);
+	DrawPlaneHand(canvas,2,time.second_/5,time.second_%5,style.second_,time.update_);
+	} // DrawPlaneSecond
+
+void DrawPlaneMinute(const ClockTime & time, const void * param, LayerCanvas & canvas)
+	{
+	const HandsStyle & style = *static_cast<const HandsStyle*>(param);
+	DrawPlaneHand(canvas,1,time.minute_/5,time.minute_%5,style.minute_,time.update_);
+	} // DrawPlaneMinute
+
+// the hour counts which set of 12 minutes within the hour
+void DrawPlaneHour(const ClockTime & time, const void * param, LayerCanvas & canvas)
+	{
+	const HandsStyle & style = *static_cast<const HandsStyle*>(param);
+	DrawPlaneHand(canvas,0,HourHand(time.hour_),time.minute_/12,style.hour_,time.update_);
+	} // DrawPlaneHour
+
+// each 1/12 second, advance to the next led along the edge of the front plane
+void DrawPlaneUpdate(const ClockTime & time, const void *, LayerCanvas & canvas)
+	{
+	const DiagonalHand & hand = DiagonalHands[HourHand(time.update_)];
+	SetColor(canvas,hand.col_,3,hand.row_,white);
+	} // DrawPlaneUpdate
+
+// the plane hands as bitboards, drawing the same voxels
+void DrawFiveSecondSquareBits(const ClockTime & time, const void * param, BitboardCanvas & canvas)
+	{
+	const HandsStyle & style = *static_cast<const HandsStyle*>(param);
+	const uint8 (&square)[4][2] = FiveSecondSquares[time.second_%5];
+	uint64 lit = 0;
+	for (int led = 0; led < 4; ++led)
+		lit |= BitboardCanvas::Bit(square[led][0],3,square[led][1]);
+	AddColor(canvas,lit,style.square_);
+	} // DrawFiveSecondSquareBits
+
+void DrawPlaneHandBits(BitboardCanvas & canvas, int j, int index, int count,
+		const HandStyle & style, int update)
+	{
+	const PlaneHand & hand = PlaneHands[index];
+	const Color & progress = ((true == style.blinks_) && (0 == update%2)) ?
+		style.blink_ : style.progress_;
+	uint64 base = 0, counted = 0;
+	for (int led = 0; led < 4; ++led)
+		{
+		uint64 bit = BitboardCanvas::Bit(hand.led_[led].col_,j,hand.led_[led].z_);
+		base |= bit;
+		if (4-count <= led)
+			counted |= bit;
+		}
+	AddColor(canvas,base,style.base_);
+	AddColor(canvas,counted,progress);
+	} // DrawPlaneHandBits
+
+void DrawPlaneSecondBits(const ClockTime & time, const void * param, BitboardCanvas & canvas)
+	{
+	const HandsStyle & style = *static_cast<const HandsStyle*>(param);
+	DrawPlaneHandBits(canvas,2,time.second_/5,time.second_%5,style.second_,time.update_);
+	} // DrawPlaneSecondBits
+
+void DrawPlaneMinuteBits(const ClockTime & time, const void * param, BitboardCanvas & canvas)
+	{
+	const HandsStyle & style = *static_cast<const HandsStyle*>(param);
+	DrawPlaneHandBits(canvas,1,time.minute_/5,time.minute_%5,style.minute_,time.update_);
+	} // DrawPlaneMinuteBits
+
+void DrawPlaneHourBits(const ClockTime & time, const void * param, BitboardCanvas & canvas)
+	{
+	const HandsStyle & style = *static_cast<const HandsStyle*>(param);
+	DrawPlaneHandBits(canvas,0,HourHand(time.hour_),time.minute_/12,style.hour_,time.update_);
+	} // DrawPlaneHourBits
+
+void DrawPlaneUpdateBits(const ClockTime & time, const void *, BitboardCanvas & canvas)
+	{
+	const DiagonalHand & hand = DiagonalHands[HourHand(time.update_)];
+	AddColor(canvas,BitboardCanvas::Bit(hand.col_,3,hand.row_),white);
+	} // DrawPlaneUpdateBits
+
+const HandsStyle ColorfulStyle = {
+	{0,255,0},
+	{{255,255,0}, {0,0,255},   {0,0,255},   false},
+	{{255,255,255}, {255,0,0}, {255,0,0},   false},
+	{{255,0,255}, {255,100,0}, {255,100,0}, false}  // medium orange
+	};
+
+const HandsStyle MonochromeStyle = {
+	{255,255,0},
+	{{0,0,60}, {0,0,255}, {0,0,255}, false},
+	{{60,0,0}, {255,0,0}, {255,0,0}, false},
+	{{0,60,0}, {0,255,0}, {0,255,0}, false}
+	};
+
+const HandsStyle BlinkyStyle = {
+	{255,255,0},
+	{{0,0,255}, {0,0,255}, {20,20,120}, true},
+	{{255,0,0}, {255,0,0}, {120,10,10}, true},
+	{{0,255,0}, {0,255,0}, {10,140,10}, true}
+	};
+
+const ClockLayer ColorfulLayers[] = {
+	{ClockSecond,             DrawFiveSecondSquare, &ColorfulStyle},
+	{ClockSecond,             DrawPlaneSecond,      &ColorfulStyle},
+	{ClockMinute,             DrawPlaneMinute,      &ColorfulStyle},
+	{ClockHour|ClockMinute,   DrawPlaneHour,        &ColorfulStyle},
+	{ClockUpdate,             DrawPlaneUpdate,      0}
+	};
+
+const ClockLayer MonochromeLayers[] = {
+	{ClockSecond,             DrawFiveSecondSquare, &MonochromeStyle},
+	{ClockSecond,             DrawPlaneSecond,      &MonochromeStyle},
+	{ClockMinute,             DrawPlaneMinute,      &MonochromeStyle},
+	{ClockHour|ClockMinute,   DrawPlaneHour,        &MonochromeStyle},
+	{ClockUpdate,             DrawPlaneUpdate,      0}
+	};
+
+const ClockLayer BlinkyLayers[] = {
+	{ClockSecond,                         DrawFiveSecondSquare, &BlinkyStyle},
+	{ClockSecond|ClockUpdate,             DrawPlaneSecond,      &BlinkyStyle},
+	{ClockMinute|ClockUpdate,             DrawPlaneMinute,      &BlinkyStyle},
+	{ClockHour|ClockMinute|ClockUpdate,   DrawPlaneHour,        &BlinkyStyle},
+	{ClockUpdate,                         DrawPlaneUpdate,      0}
+	};
+
+const BitClockLayer ColorfulBits[] = {
+	{DrawFiveSecondSquareBits, &ColorfulStyle},
+	{DrawPlaneSecondBits,      &ColorfulStyle},
+	{DrawPlaneMinuteBits,      &ColorfulStyle},
+	{DrawPlaneHourBits,        &ColorfulStyle},
+	{DrawPlaneUpdateBits,      0}
+	};
+
+const BitClockLayer MonochromeBits[] = {
+	{DrawFiveSecondSquareBits, &MonochromeStyle},
+	{DrawPlaneSecondBits,      &MonochromeStyle},
+	{DrawPlaneMinuteBits,      &MonochromeStyle},
+	{DrawPlaneHourBits,        &MonochromeStyle},
+	{DrawPlaneUpdateBits,      0}
+	};
+
+const BitClockLayer BlinkyBits[] = {
+	{DrawFiveSecondSquareBits, &BlinkyStyle},
+	{DrawPlaneSecondBits,      &BlinkyStyle},
+	{DrawPlaneMinuteBits,      &BlinkyStyle},
+	{DrawPlaneHourBits,        &BlinkyStyle},
+	{DrawPlaneUpdateBits,      0}
+	};
+
+/***************************** Plane Clock ********************************/
+/* Each horizontal plane is a quarter of the circle, 15 minutes or seconds,
+   filled an led at a time. There are 16 leds per plane, so the x=y=0 column
+   is not counted and is used for the subsecond indicator instead. Minute 0
+   and second 0 count as 60 so the cube is full rather than empty.
+*/
+
+// next led to fill after index, skipping the x=y=0 column
+int PlaneClockStep(int index)
+	{
+	++index;
+	if (0 == (index&15))
+		++index;
+	return index;
+	}
+
+// index of the last led filled for count 0-59, 15 to a plane
+int PlaneClockLast(int count)
+	{
+	if (0 == count)
+		count = 60;
+	return count + (count-1)/15;
+	}
+
+void SetPlaneClock(LayerCanvas & canvas, int index, const Color & color)
+	{
+	SetColor(canvas,index&3,(index>>2)&3,index>>4,color);
+	}
+
+void DrawPlaneClockMinute(const ClockTime & time, const void *, LayerCanvas & canvas)
+	{
+	int last = PlaneClockLast(time.minute_);
+	for (int index = PlaneClockStep(-1); index <= last; index = PlaneClockStep(index))
+		SetPlaneClock(canvas,index,blue);
+	} // DrawPlaneClockMinute
+
+// seconds are magenta where they overlap the minutes, else red
+void DrawPlaneClockSecond(const ClockTime & time, const void *, LayerCanvas & canvas)
+	{
+	const Color magenta = {255,0,255};
+	int minute = PlaneClockLast(time.minute_);
+	int last   = PlaneClockLast(time.second_);
+	for (int index = PlaneClockStep(-1); index <= last; index = PlaneClockStep(index))
+		SetPlaneClock(canvas,index,(index <= minute) ? magenta : red);
+	} // DrawPlaneClockSecond
+
+// the hour is a single led along the edge of the top plane
+void DrawPlaneClockHour(const ClockTime & time, const void *, LayerCanvas & canvas)
+	{
+	const DiagonalHand & hand = DiagonalHands[HourHand(time.hour_)];
+	SetColor(canvas,hand.col_,hand.row_,3,green);
+	} // DrawPlaneClockHour
+
+// twinkle the current second and minute to make them easier to find
+void DrawPlaneClockTwinkle(const ClockTime & time, const void *, LayerCanvas & canvas)
+	{
+	if (0 == time.update_%2)
+		return;
+	const Color dimBlue = {0,0,60}, dimRed = {60,0,0};
+	SetPlaneClock(canvas,PlaneClockLast(time.minute_),dimBlue);
+	SetPlaneClock(canvas,PlaneClockLast(time.second_),dimRed);
+	} // DrawPlaneClockTwinkle
+
+// the subsecond indicator climbs the x=y=0 column 4 times a second
+void DrawPlaneClockUpdate(const ClockTime & time, const void *, LayerCanvas & canvas)
+	{
+	SetColor(canvas,0,0,time.update_/3,white);
+	} // DrawPlaneClockUpdate
+
+// bit of led index, and bits of every led filled up to and including it
+constexpr uint64 PlaneClockBit(int index)
+	{
+	return BitboardCanvas::Bit(index&3,(index>>2)&3,index>>4);
+	}
+constexpr uint64 PlaneClockFill(int last)
+	{
+	return (last < 0) ? 0 : (((0 != (last&15)) ? PlaneClockBit(last) : 0) | PlaneClockFill(last-1));
+	}
+
+#define PLANE_FILLS4(n)  PlaneClockFill(n), PlaneClockFill(n+1), PlaneClockFill(n+2), PlaneClockFill(n+3)
+#define PLANE_FILLS16(n) PLANE_FILLS4(n), PLANE_FILLS4(n+4), PLANE_FILLS4(n+8), PLANE_FILLS4(n+12)
+
+// leds filled through each index, as bitboards
+constexpr uint64 PlaneClockFills[64] = {
+	PLANE_FILLS16(0), PLANE_FILLS16(16), PLANE_FILLS16(32), PLANE_FILLS16(48)
+	};
+
+#undef PLANE_FILLS16
+#undef PLANE_FILLS4
+
+void DrawPlaneClockMinuteBits(const ClockTime & time, const void *, BitboardCanvas & canvas)
+	{
+	AddColor(canvas,PlaneClockFills[PlaneClockLast(time.minute_)],blue);
+	} // DrawPlaneClockMinuteBits
+
+// the minutes and seconds overlap where both fills are set
+void DrawPlaneClockSecondBits(const ClockTime & time, const void *, BitboardCanvas & canvas)
+	{
+	const Color magenta = {255,0,255};
+	uint64 seconds = PlaneClockFills[PlaneClockLast(time.second_)];
+	AddColor(canvas,seconds,red);
+	AddColor(canvas,seconds & PlaneClockFills[PlaneClockLast(time.minute_)],magenta);
+	} // DrawPlaneClockSecondBits
+
+void DrawPlaneClockHourBits(const ClockTime & time, const void *, BitboardCanvas & canvas)
+	{
+	const DiagonalHand & hand = DiagonalHands[HourHand(time.hour_)];
+	AddColor(canvas,BitboardCanvas::Bit(hand.col_,hand.row_,3),green);
+	} // DrawPlaneClockHourBits
+
+void DrawPlaneClockTwinkleBits(const ClockTime & time, const void *, BitboardCanvas & canvas)
+	{
+	if (0 == time.update_%2)
+		return;
+	const Color dimBlue = {0,0,60}, dimRed = {60,0,0};
+	AddColor(canvas,PlaneClockBit(PlaneClockLast(time.minute_)),dimBlue);
+	AddColor(canvas,PlaneClockBit(PlaneClockLast(time.second_)),dimRed);
+	} // DrawPlaneClockTwinkleBits
+
+void DrawPlaneClockUpdateBits(const ClockTime & time, const void *, BitboardCanvas & canvas)
+	{
+	AddColor(canvas,BitboardCanvas::Bit(0,0,time.update_/3),white);
+	} // DrawPlaneClockUpdateBits
+
+const ClockLayer PlaneLayers[] = {
+	{ClockMinute,                         DrawPlaneClockMinute,  0},
+	{ClockMinute|ClockSecond,             DrawPlaneClockSecond,  0},
+	{ClockHour,                           DrawPlaneClockHour,    0},
+	{ClockMinute|ClockSecond|ClockUpdate, DrawPlaneClockTwinkle, 0},
+	{ClockUpdate,                         DrawPlaneClockUpdate,  0}
+	};
+
+const BitClockLayer PlaneBits[] = {
+	{DrawPlaneClockMinuteBits,  0},
+	{DrawPlaneClockSecondBits,  0},
+	{DrawPlaneClockHourBits,    0},
+	{DrawPlaneClockTwinkleBits, 0},
+	{DrawPlaneClockUpdateBits,  0}
+	};
+
+const ClockLayer TestLayers[] = {
+	{0, DrawGradient, 0}
+	};
+
+#define LAYERS(l) l, sizeof(l)/sizeof(l[0])
+
+// the registry, in menu order. The gradient has a color per voxel, so
+// is not drawn as bitboards
+const ClockFace ClockFaces[] = {
+	{'0', "Fill cube with all colors", LAYERS(TestLayers),       0, 0},
+	{'1', "EarlyClock",                LAYERS(EarlyLayers),      LAYERS(EarlyBits)},
+	{'2', "PaddleClock",               LAYERS(PaddleLayers),     LAYERS(PaddleBits)},
+	{'3', "HandsClock Colorful",       LAYERS(ColorfulLayers),   LAYERS(ColorfulBits)},
+	{'4', "HandsClock Monochrome",     LAYERS(MonochromeLayers), LAYERS(MonochromeBits)},
+	{'5', "HandsClock Blinky",         LAYERS(BlinkyLayers),     LAYERS(BlinkyBits)},
+	{'6', "PlaneClock",                LAYERS(PlaneLayers),      LAYERS(PlaneBits)}
+	};
+
+#undef LAYERS
+
+// copy the voxels a layer drew over the canvas
+void Composite(const LayerCanvas & layer, Canvas & canvas)
+	{
+	uint64 lit = layer.lit_;
+	for (int index = 0; 0 != lit; ++index, lit >>= 1)
+		if (lit & 1)
+			{
+			const uint8 * rgb = layer.canvas_.GetIndex(index);
+			canvas.SetIndex(index,rgb[0],rgb[1],rgb[2]);
+			}
+	} // Composite
+
+	}; // anonymous namespace
+
+// zero the fields not in the ClockField bits
+ClockTime MaskClockTime(const ClockTime & time, uint8 fields)
+	{
+	ClockTime masked = time;
+	if (0 == (fields & ClockHour))
+		masked.hour_ = 0;
+	if (0 == (fields & ClockMinute))
+		masked.minute_ = 0;
+	if (0 == (fields & ClockSecond))
+		masked.second_ = 0;
+	if (0 == (fields & ClockUpdate))
+		masked.update_ = 0;
+	return masked;
+	} // MaskClockTime
+
+// all the fields the face depends on
+uint8 ClockFace::Fields(void) const
+	{
+	uint8 fields = 0;
+	for (int layer = 0; layer < layerCount_; ++layer)
+		fields |= layers_[layer].fields_;
+	return fields;
+	} // Fields
+
+int ClockFaceCount(void)
+	{
+	return sizeof(ClockFaces)/sizeof(ClockFaces[0]);
+	}
+
+const ClockFace & GetClockFace(int index)
+	{
+	return ClockFaces[index];
+	}
+
+const ClockFace * FindClockFace(char key)
+	{
+	for (int index = 0; index < ClockFaceCount(); ++index)
+		if (key == ClockFaces[index].key_)
+			return &ClockFaces[index];
+	return 0;
+	} // FindClockFace
+
+// draw every layer of a face
+void RenderClock(const ClockFace & face, const ClockTime & time, Canvas & canvas)
+	{
+	LayerCanvas layer;
+	canvas.Clear();
+	for (int index = 0; index < face.layerCount_; ++index)
+		{
+		layer.Clear();
+		face.layers_[index].draw_(time,face.layers_[index].param_,layer);
+		Composite(layer,canvas);
+		}
+	} // RenderClock
+
+// draw a face as bitboards straight to a packed frame
+bool RenderClockBits(const ClockFace & face, const ClockTime & time, uint8 * frame)
+	{
+	if (0 == face.bitLayers_)
+		return false;
+	BitboardCanvas canvas;
+	for (int index = 0; index < face.bitLayerCount_; ++index)
+		face.bitLayers_[index].draw_(time,face.bitLayers_[index].param_,canvas);
+	canvas.Pack(frame);
+	return true;
+	} // RenderClockBits
+
+// From the top layer down, each layer shows only where no layer above it is
+// lit, so every voxel is written once. Each byte of what a layer shows is
+// 8 voxels, expanded to their 12 frame bytes in the layer's color.
+void BitboardCanvas::Pack(uint8 * frame) const
+	{
+	memset(frame,0,CanvasFrameSize);
+	uint64 covered = 0;
+	for (int index = count_-1; (0 <= index) && (~0ULL != covered); --index)
+		{
+		const Layer & layer = layers_[index];
+		uint64 shown = layer.lit_ & ~covered;
+		covered |= layer.lit_;
+		for (uint8 * out = frame; 0 != shown; shown >>= 8, out += 12)
+			{
+			if (0 == (shown & 255))
+				continue;
+			// the 12 bytes as a 64 and a 32 bit word
+			const uint8 * mask = BitboardBytes[shown & 255].mask_;
+			uint64 low, lowMask;
+			uint32 high, highMask;
+			memcpy(&low,out,8);
+			memcpy(&high,out+8,4);
+			memcpy(&lowMask,mask,8);
+			memcpy(&highMask,mask+8,4);
+			low  |= lowMask  & layer.low_;
+			high |= highMask & layer.high_;
+			memcpy(out,&low,8);
+			memcpy(out+8,&high,4);
+			}
+		}
+	} // Pack
+
+ClockEngine::ClockEngine(void) : face_(0), valid_(false), layerDraws_(0)
+	{
+	} // ClockEngine
+
+// set the face to draw, forgets all layers
+void ClockEngine::SetFace(const ClockFace * face)
+	{
+	face_  = face;
+	valid_ = false;
+	layers_.resize(0 == face ? 0 : face->layerCount_);
+	} // SetFace
+
+// draw the face for the time, redrawing only layers whose fields changed
+void ClockEngine::Render(const ClockTime & time, Canvas & canvas)
+	{
+	canvas.Clear();
+	if (0 == face_)
+		return;
+
+	uint8 changed = ClockAll;
+	if (true == valid_)
+		{
+		changed = 0;
+		if (time.hour_ != last_.hour_)
+			changed |= ClockHour;
+		if (time.minute_ != last_.minute_)
+			changed |= ClockMinute;
+		if (time.second_ != last_.second_)
+			changed |= ClockSecond;
+		if (time.update_ != last_.update_)
+			changed |= ClockUpdate;
+		}
+
+	for (int index = 0; index < face_->layerCount_; ++index)
+		{
+		const ClockLayer & layer = face_->layers_[index];
+		if ((false == valid_) || (0 != (layer.fields_ & changed)))
+			{
+			layers_[index].Clear();
+			layer.draw_(time,layer.param_,layers_[index]);
+			++layerDraws_;
+			}
+		Composite(layers_[index],canvas);
+		}
+
+	last_  = time;
+	valid_ = true;
+	} // Render
+
+}; // namespace HypnoGadget
+
+// end - ClockRender.cpp
@@ -0,0 +1,193 @@
+// HypnoCOMM - serial communications for the HypnoGadgets
+// www.HypnoCube.com, www.HypnoSquare.com
+// header for drawing clock faces on the HypnoCube
+#ifndef CLOCKRENDER_H
+#define CLOCKRENDER_H
+
+#include "defines.h"
+#include "Canvas.h"
+#include <vector>
+
+namespace HypnoGadget {
+
+// time fields a clock layer is drawn from, as bits
+enum ClockField
+	{
+	ClockHour   = 1,
+	ClockMinute = 2,
+	ClockSecond = 4,
+	ClockUpdate = 8, // update count within the second
+	ClockAll    = 15
+	};
+
+// the time a clock frame shows
+struct ClockTime
+	{
+	int hour_;   // 0-23
+	int minute_; // 0-59
+	int second_; // 0-59
+	int update_; // 0-11, which twelfth of the second
+	};
+
+// zero the fields not in the ClockField bits, so times that
+// draw the same frame compare equal
+ClockTime MaskClockTime(const ClockTime & time, uint8 fields);
+
+// a layer draws the voxels it wants lit, and remembers which
+class LayerCanvas
+	{
+public:
+	LayerCanvas(void) : lit_(0) {}
+
+	void Clear(void)
+		{
+		canvas_.Clear();
+		lit_ = 0;
+		}
+
+	// set voxel i,j,k to the color, ignoring voxels outside the cube
+	void Set(int i, int j, int k, uint8 red, uint8 green, uint8 blue)
+		{
+		if ((i < 0) || (3 < i) || (j < 0) || (3 < j) || (k < 0) || (3 < k))
+			return; // nothing to do
+		int index = Canvas::Index(i,j,k);
+		canvas_.SetIndex(index,red,green,blue);
+		lit_ |= 1ULL << index;
+		}
+
+	Canvas canvas_; // colors drawn
+	uint64 lit_;    // bit n set if wire order voxel n was drawn
+	}; // class LayerCanvas
+
+/* A face drawn as bitboards: each layer is a mask of the voxels it lights,
+   in wire order, and one color. Later layers cover earlier ones, which is
+   resolved with masks from the top layer down, so each voxel's color is
+   found once and no layer is drawn as single voxels. The packed frame is
+   then filled 8 voxels at a time from BitboardBytes.
+*/
+class BitboardCanvas
+	{
+public:
+	enum {MaxLayers = 16};
+
+	BitboardCanvas(void) : count_(0) {}
+
+	void Clear(void)
+		{
+		count_ = 0;
+		}
+
+	// add a layer of voxels over those added before, ignored past MaxLayers
+	void Add(uint64 lit, uint8 red, uint8 green, uint8 blue)
+		{
+		if ((0 == lit) || (MaxLayers <= count_))
+			return; // nothing to do
+		Layer & layer = layers_[count_++];
+		layer.lit_ = lit;
+		uint8 pattern[12];
+		for (int pos = 0; pos < 12; pos += 3)
+			{
+			pattern[pos]   = (red&0xF0)   | (green>>4);
+			pattern[pos+1] = (blue&0xF0)  | (red>>4);
+			pattern[pos+2] = (green&0xF0) | (blue>>4);
+			}
+		memcpy(&layer.low_,pattern,8);
+		memcpy(&layer.high_,pattern+8,4);
+		}
+
+	// bit of voxel i,j,k in 0-3
+	static constexpr uint64 Bit(int i, int j, int k)
+		{
+		return 1ULL << Canvas::Index(i,j,k);
+		}
+
+	// pack to the CanvasFrameSize byte frame format for SetFrame
+	void Pack(uint8 * frame) const;
+
+private:
+	struct Layer
+		{
+		uint64 lit_;  // bit n set if wire order voxel n is this color
+		uint64 low_;  // the color packed for 8 voxels, R G, B R, G B four times,
+		uint32 high_; // as the first 8 bytes and the last 4
+		};
+	Layer layers_[MaxLayers];
+	int count_;
+	}; // class BitboardCanvas
+
+// one layer of a clock face. Faces draw layers in order, so later
+// layers cover earlier ones, and a layer is only redrawn when one of
+// the time fields it depends on changes
+struct ClockLayer
+	{
+	uint8 fields_; // ClockField bits this layer depends on
+	void (*draw_)(const ClockTime & time, const void * param, LayerCanvas & canvas);
+	const void * param_; // passed to draw_, such as colors
+	};
+
+// the same face drawn as bitboards, a layer each for the hour, minute,
+// second and update hands, each adding one or more colored masks
+struct BitClockLayer
+	{
+	void (*draw_)(const ClockTime & time, const void * param, BitboardCanvas & canvas);
+	const void * param_; // passed to draw_, such as colors
+	};
+
+// a clock face, made of layers
+struct ClockFace
+	{
+	char key_;            // menu key
+	const char * name_;   // menu name
+	const ClockLayer * layers_;
+	int layerCount_;
+	const BitClockLayer * bitLayers_; // 0 if the face is not drawn as bitboards
+	int bitLayerCount_;
+
+	// all the fields the face depends on
+	uint8 Fields(void) const;
+	};
+
+// the registry of clock faces
+int ClockFaceCount(void);
+const ClockFace & GetClockFace(int index);
+const ClockFace * FindClockFace(char key); // 0 if none
+
+// draw every layer of a face
+void RenderClock(const ClockFace & face, const ClockTime & time, Canvas & canvas);
+
+// draw a face as bitboards straight to a CanvasFrameSize byte frame,
+// giving the same frame as RenderClock then Pack. False if the face
+// has no bitboard layers
+bool RenderClockBits(const ClockFace & face, const ClockTime & time, uint8 * frame);
+
+/* Draws frames of one face, keeping each layer's drawing between frames
+   and only redrawing layers whose time fields changed, so hour layers are
+   drawn once an hour and minute layers once a minute.
+*/
+class ClockEngine
+	{
+public:
+	ClockEngine(void);
+
+	// set the face to draw, forgets all layers
+	void SetFace(const ClockFace * face);
+	const ClockFace * GetFace(void) const { return face_; }
+
+	// draw the face for the time onto canvas
+	void Render(const ClockTime & time, Canvas & canvas);
+
+	// count of layers drawn, to see the savings
+	uint32 LayerDraws(void) const { return layerDraws_; }
+
+private:
+	const ClockFace * face_;
+	std::vector<LayerCanvas> layers_; // last drawing of each layer
+	ClockTime last_;   // time layers were last drawn for
+	bool valid_;       // false until layers drawn once
+	uint32 layerDraws_;
+	}; // class ClockEngine
+
+}; // namespace HypnoGadget
+
+#endif // CLOCKRENDER_H
+// end - ClockRender.h
@@ -0,0 +1,100 @@
+// HypnoCOMM - serial communications for the HypnoGadgets
+// www.HypnoCube.com, www.HypnoSquare.com
+// counting errors by code and commands by type
+#include "ErrorCounters.h"
+#include <cstdio>
+
+using namespace std;
+
+namespace HypnoGadget {
+
+namespace {
+
+const char * const ErrorTexts[] = {
+     "0 = no error",
+     "1 = timeout - too long of a delay between packets.",
+     "2 = missing packet, followed by missing sequence number.",
+     "3 = invalid checksum.",
+     "4 = invalid type (2 and 3 defined for now).",
+     "5 = invalid sequence counter.",
+     "6 = missing SYNC - SYNC out of order (2 SYNC in a row, for example).",
+     "7 = invalid packet length.",
+     "8 = invalid command.",
+     "9 = invalid data (valid command).",
+    "10 = invalid ESC sequence - illegal byte after ESC byte.",
+    "11 = overflow - too much data was fed in with the packets.",
+    "12 = command not implemented (in case command deliberately not allowed).",
+    "13 = invalid login value."
+	};
+
+	}; // anonymous namespace
+
+const char * ErrorText(uint8 code)
+	{
+	if (code < sizeof(ErrorTexts)/sizeof(ErrorTexts[0]))
+		return ErrorTexts[code];
+	return "unknown error code";
+	} // ErrorText
+
+ErrorCounters::ErrorCounters(void)
+	{
+	Clear();
+	} // ErrorCounters
+
+void ErrorCounters::Get(ErrorCounts & counts) const
+	{
+	for (int code = 0; code < ErrorCodeCount; ++code)
+		{
+		counts.decoded_[code]  = decoded_[code].load(memory_order_relaxed);
+		counts.reported_[code] = reported_[code].load(memory_order_relaxed);
+		}
+	for (int command = 0; command < CommandTypeCount; ++command)
+		{
+		counts.received_[command] = received_[command].load(memory_order_relaxed);
+		counts.rejected_[command] = rejected_[command].load(memory_order_relaxed);
+		}
+	} // Get
+
+void ErrorCounters::Clear(void)
+	{
+	for (int code = 0; code < ErrorCodeCount; ++code)
+		{
+		decoded_[code].store(0,memory_order_relaxed);
+		reported_[code].store(0,memory_order_relaxed);
+		}
+	for (int command = 0; command < CommandTypeCount; ++command)
+		{
+		received_[command].store(0,memory_order_relaxed);
+		rejected_[command].store(0,memory_order_relaxed);
+		}
+	} // Clear
+
+void ErrorReport(const ErrorCounts & counts, string & text)
+	{
+	char line[200];
+	text = "   decoded  reported  error\n";
+	for (int code = 1; code < ErrorCodeCount; ++code)
+		{
+		if ((0 == counts.decoded_[code]) && (0 == counts.reported_[code]))
+			continue;
+		sprintf(line,"%10lu %9lu  %s\n",
+			static_cast<unsigned long>(counts.decoded_[code]),
+			static_cast<unsigned long>(counts.reported_[code]),
+			ErrorText(static_cast<uint8>(code)));
+		text += line;
+		}
+	text += "command     received  rejected\n";
+	for (int command = 0; command < CommandTypeCount; ++command)
+		{
+		if (0 == counts.received_[command])
+			continue;
+		sprintf(line,"%7d %12lu %9lu\n",command,
+			static_cast<unsigned long>(counts.received_[command]),
+			static_cast<unsigned long>(counts.rejected_[command]));
+		text += line;
+		}
+	} // ErrorReport
+
+}; // namespace HypnoGadget
+
+// end - ErrorCounters.cpp
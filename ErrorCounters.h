@@ -0,0 +1,71 @@
+// HypnoCOMM - serial communications for the HypnoGadgets
+// www.HypnoCube.com, www.HypnoSquare.com
+// header for counting errors by code and commands by type
+#ifndef ERRORCOUNTERS_H
+#define ERRORCOUNTERS_H
+
+#include "defines.h"
+#include <atomic>
+#include <string>
+
+namespace HypnoGadget {
+
+enum {
+	ErrorCodeCount   = 16,  // error codes from the spec, PacketError and up, plus room
+	CommandTypeCount = 256  // a command is a byte
+	};
+
+// text for an error code from the spec, for codes past the table too
+const char * ErrorText(uint8 code);
+
+// a copy of the counters, to read and report at leisure
+struct ErrorCounts
+	{
+	uint64 decoded_[ErrorCodeCount];    // PacketErrors our decoder found
+	uint64 reported_[ErrorCodeCount];   // codes in Error commands from the gadget
+	uint64 received_[CommandTypeCount]; // commands from the gadget, by type
+	uint64 rejected_[CommandTypeCount]; // of those, ones unknown, illegal or the wrong size
+	};
+
+// table of the counts that are not 0, with the text for each error code
+void ErrorReport(const ErrorCounts & counts, std::string & text);
+
+/* Counts that cost one atomic add to keep, with no strings built or
+   allocated, so a burst of errors on a noisy line is counted in full and
+   cheaply. Counters are relaxed atomics, so Get may be called from any
+   thread at any time without the gadget's lock; counts taken while others
+   are added are each exact but not a single instant across all of them.
+*/
+class ErrorCounters
+	{
+public:
+	ErrorCounters(void);
+
+	void Decoded(uint8 code)     { Add(decoded_,ErrorCodeCount,code); }
+	void Reported(uint8 code)    { Add(reported_,ErrorCodeCount,code); }
+	void Received(uint8 command) { received_[command].fetch_add(1,std::memory_order_relaxed); }
+	void Rejected(uint8 command) { rejected_[command].fetch_add(1,std::memory_order_relaxed); }
+
+	void Get(ErrorCounts & counts) const;
+	void Clear(void);
+
+private:
+	std::atomic<uint64> decoded_[ErrorCodeCount];
+	std::atomic<uint64> reported_[ErrorCodeCount];
+	std::atomic<uint64> received_[CommandTypeCount];
+	std::atomic<uint64> rejected_[CommandTypeCount];
+
+	// codes past the table count in its last entry
+	static void Add(std::atomic<uint64> * counters, int count, uint8 code)
+		{
+		counters[(code < count) ? code : count-1].fetch_add(1,std::memory_order_relaxed);
+		}
+
+	ErrorCounters(const ErrorCounters &);             // not copyable
+	ErrorCounters & operator=(const ErrorCounters &);
+	}; // class ErrorCounters
+
+}; // namespace HypnoGadget
+
+#endif // ERRORCOUNTERS_H
+// end - ErrorCounters.h
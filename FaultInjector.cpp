@@ -0,0 +1,85 @@
+// HypnoCOMM - serial communications for the HypnoGadgets
+// www.HypnoCube.com, www.HypnoSquare.com
+// damaging a byte stream on purpose, to test recovery
+#include "FaultInjector.h"
+#include "Packet.h"
+#include <cstring>
+
+using namespace std;
+
+namespace HypnoGadget {
+
+FaultInjector::FaultInjector(uint32 seed) : seed_(0 == seed ? 1 : seed), offset_(0)
+	{
+	for (int type = 0; type < FaultTypeCount; ++type)
+		rate_[type] = 0;
+	} // FaultInjector
+
+void FaultInjector::SetRate(FaultType type, uint32 perMillion)
+	{
+	if ((0 <= type) && (type < FaultTypeCount))
+		rate_[type] = perMillion;
+	} // SetRate
+
+// xorshift, small and repeatable everywhere
+uint32 FaultInjector::Random(void)
+	{
+	seed_ ^= seed_ << 13;
+	seed_ ^= seed_ >> 17;
+	seed_ ^= seed_ << 5;
+	return seed_;
+	} // Random
+
+void FaultInjector::Pass(const uint8 * bytes, uint16 length, vector<uint8> & out)
+	{
+	for (uint16 pos = 0; pos < length; ++pos, ++offset_)
+		{
+		uint8 byte = bytes[pos];
+		Fault fault = {FaultTypeCount, offset_};
+		if ((0 != rate_[FaultDropByte]) && (Random() % 1000000 < rate_[FaultDropByte]))
+			fault.type_ = FaultDropByte;
+		else if ((0 != rate_[FaultBitFlip]) && (Random() % 1000000 < rate_[FaultBitFlip]))
+			fault.type_ = FaultBitFlip;
+		else if ((PacketSYNC == byte) && (0 != rate_[FaultDuplicateSync]) && (Random() % 1000000 < rate_[FaultDuplicateSync]))
+			fault.type_ = FaultDuplicateSync;
+
+		switch (fault.type_)
+			{
+			case FaultDropByte :
+				break;
+			case FaultBitFlip :
+				out.push_back(static_cast<uint8>(byte ^ (1 << (Random() & 7))));
+				break;
+			case FaultDuplicateSync :
+				out.push_back(byte);
+				out.push_back(byte);
+				break;
+			default :
+				out.push_back(byte);
+				break;
+			}
+		if (FaultTypeCount != fault.type_)
+			faults_.push_back(fault);
+		}
+	} // Pass
+
+uint16 FaultIO::ReadBytes(uint8 * buffer, uint16 length)
+	{
+	if (damaged_.size() < length)
+		{
+		uint8 clean[256];
+		uint16 count = io_.ReadBytes(clean,sizeof(clean));
+		injector_.Pass(clean,count,damaged_);
+		}
+	uint16 count = static_cast<uint16>((damaged_.size() < length) ? damaged_.size() : length);
+	if (0 != count)
+		{
+		memcpy(buffer,&damaged_[0],count);
+		damaged_.erase(damaged_.begin(),damaged_.begin()+count);
+		}
+	return count;
+	} // ReadBytes
+
+}; // namespace HypnoGadget
+
+// end - FaultInjector.cpp
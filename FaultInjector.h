@@ -0,0 +1,84 @@
+// HypnoCOMM - serial communications for the HypnoGadgets
+// www.HypnoCube.com, www.HypnoSquare.com
+// header for damaging a byte stream on purpose, to test recovery
+#ifndef FAULTINJECTOR_H
+#define FAULTINJECTOR_H
+
+#include "defines.h"
+#include "Gadget.h"
+#include <vector>
+
+namespace HypnoGadget {
+
+// ways a serial line goes wrong
+enum FaultType {
+	FaultBitFlip,       // one bit of a byte changed
+	FaultDropByte,      // a byte lost
+	FaultDuplicateSync, // a SYNC seen twice
+	FaultTypeCount
+	};
+
+// one fault, at the offset in the clean stream of the byte it hit
+struct Fault
+	{
+	FaultType type_;
+	uint64 at_;
+	};
+
+/* Passes bytes through, damaging some at random with the chance per byte
+   set for each type. The same seed gives the same faults, so a run can be
+   repeated. Every fault is logged with where it happened in the clean
+   stream, so a test can find how long the decoder took to recover.
+*/
+class FaultInjector
+	{
+public:
+	FaultInjector(uint32 seed = 1);
+
+	// chance of the fault per byte, in parts per million
+	void SetRate(FaultType type, uint32 perMillion);
+
+	// damage length bytes, appending what comes out to out
+	void Pass(const uint8 * bytes, uint16 length, std::vector<uint8> & out);
+
+	uint64 Offset(void) const { return offset_; } // clean bytes passed
+	const std::vector<Fault> & Faults(void) const { return faults_; }
+	void ClearFaults(void) { faults_.clear(); }
+
+private:
+	uint32 seed_;
+	uint32 rate_[FaultTypeCount];
+	uint64 offset_;
+	std::vector<Fault> faults_;
+
+	uint32 Random(void);
+	}; // class FaultInjector
+
+/* GadgetIO that damages what is read from another, so GadgetControl can be
+   run against a noisy line. Writes go through untouched.
+*/
+class FaultIO : public GadgetIO
+	{
+public:
+	FaultIO(GadgetIO & io, FaultInjector & injector) : io_(io), injector_(injector)
+		{
+		}
+	uint16 ReadBytes(uint8 * buffer, uint16 length);
+	void WriteBytes(const uint8 * buffer, uint16 length)
+		{
+		io_.WriteBytes(buffer,length);
+		}
+
+private:
+	GadgetIO & io_;
+	FaultInjector & injector_;
+	std::vector<uint8> damaged_; // read and damaged, not handed out yet
+
+	FaultIO(const FaultIO &);             // not copyable
+	FaultIO & operator=(const FaultIO &);
+	}; // class FaultIO
+
+}; // namespace HypnoGadget
+
+#endif // FAULTINJECTOR_H
+// end - FaultInjector.h
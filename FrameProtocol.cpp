@@ -0,0 +1,47 @@
+// HypnoCOMM - serial communications for the HypnoGadgets
+// www.HypnoCube.com, www.HypnoSquare.com
+// the socket protocol between hypnod and its clients
+#include "FrameProtocol.h"
+
+namespace HypnoGadget {
+
+void FrameHeaderWrite(const FrameHeader & header, uint8 * bytes)
+	{
+	bytes[0] = header.type_;
+	bytes[1] = header.count_;
+	bytes[2] = static_cast<uint8>(header.length_);
+	bytes[3] = static_cast<uint8>(header.length_ >> 8);
+	for (int pos = 0; pos < 4; ++pos)
+		bytes[4+pos] = static_cast<uint8>(header.sequence_ >> (8*pos));
+	} // FrameHeaderWrite
+
+bool FrameHeaderRead(const uint8 * bytes, FrameHeader & header)
+	{
+	header.type_     = bytes[0];
+	header.count_    = bytes[1];
+	header.length_   = static_cast<uint16>(bytes[2] | (bytes[3] << 8));
+	header.sequence_ = 0;
+	for (int pos = 0; pos < 4; ++pos)
+		header.sequence_ |= static_cast<uint32>(bytes[4+pos]) << (8*pos);
+
+	switch (header.type_)
+		{
+		case FrameHello :
+			return 0 == header.length_;
+		case FrameReply :
+			return FrameReplySize == header.length_;
+		case FrameBatch :
+			return header.length_ == header.count_*FrameEntrySize;
+		default :
+			return false;
+		}
+	} // FrameHeaderRead
+
+const char * FrameServerPath(void)
+	{
+	return "/tmp/hypnod.sock";
+	} // FrameServerPath
+
+}; // namespace HypnoGadget
+
+// end - FrameProtocol.cpp
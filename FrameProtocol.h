@@ -0,0 +1,59 @@
+// HypnoCOMM - serial communications for the HypnoGadgets
+// www.HypnoCube.com, www.HypnoSquare.com
+// header for the socket protocol between hypnod and its clients
+#ifndef FRAMEPROTOCOL_H
+#define FRAMEPROTOCOL_H
+
+#include "defines.h"
+#include "WireCache.h"
+
+namespace HypnoGadget {
+
+/* Clients send frames to the daemon that owns the gadgets over a Unix
+   domain socket or loopback TCP. Every message is an 8 byte header, all
+   little endian:
+       type, count, length (2 bytes), sequence (4 bytes)
+   followed by length bytes. On connect the server sends FrameHello with
+   count the number of devices. A FrameBatch carries count entries of a
+   device number byte and a 96 byte image. The server answers each batch
+   with a FrameReply of the same sequence once every frame in it has been
+   shown, meaning its gadget ACKed it, or dropped. Count is the frames
+   shown, and the one byte body the frames dropped because a newer frame
+   for the same gadget came before they went out. The rest were for
+   gadgets not logged in, or never ACKed. Replies come in batch order.
+*/
+
+enum {
+	FrameServerPort = 7396,                // default loopback TCP port
+	FrameHeaderSize = 8,
+	FrameEntrySize  = 1 + WireFrameSize,   // device, then image
+	FrameReplySize  = 1,                   // replaced count
+	FrameBatchMax   = 255                  // entries in a batch
+	};
+
+enum FrameMessage {
+	FrameHello = 1, // server to client on connect
+	FrameBatch = 2, // client to server, frames to show
+	FrameReply = 3  // server to client, one per batch once it is shown
+	};
+
+struct FrameHeader
+	{
+	uint8 type_;      // FrameMessage
+	uint8 count_;
+	uint16 length_;   // bytes after the header
+	uint32 sequence_; // chosen by the client, echoed in the reply
+	};
+
+// header to and from its 8 bytes
+void FrameHeaderWrite(const FrameHeader & header, uint8 * bytes);
+// return false if the type is unknown or length does not match count
+bool FrameHeaderRead(const uint8 * bytes, FrameHeader & header);
+
+// default Unix domain socket path
+const char * FrameServerPath(void);
+
+}; // namespace HypnoGadget
+
+#endif // FRAMEPROTOCOL_H
+// end - FrameProtocol.h
@@ -0,0 +1,267 @@
+// HypnoCOMM - serial communications for the HypnoGadgets
+// www.HypnoCube.com, www.HypnoSquare.com
+// a shared memory ring of frames per gadget (Linux)
+#include "FrameRing.h"
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+namespace HypnoGadget {
+
+namespace {
+
+const uint32 RingMagic = 0x52505948; // "HYPR" little endian
+const int    LineSize  = 64;          // keep producers of different devices off each other's lines
+
+// bytes for one device: its control line, then two lines per slot
+size_t DeviceStride(size_t slots)
+	{
+	return LineSize + slots*2*LineSize;
+	}
+
+	}; // anonymous namespace
+
+// layout: header line, then per device a control line and its slots
+struct FrameRing::Header
+	{
+	uint32 magic_;
+	uint16 version_;
+	uint16 devices_;
+	uint32 slots_;
+	};
+
+struct FrameRing::Device
+	{
+	atomic<uint64> published_; // frames published, the newest is in slot published_-1
+	atomic<uint64> read_;      // by the driver, as NewestEncoded found them
+	atomic<uint64> torn_;
+	};
+
+struct FrameRing::Slot
+	{
+	atomic<uint32> sequence_;  // odd while being written
+	uint8 frame_[WireFrameSize];
+	};
+
+FrameRing::FrameRing(void) : header_(0), base_(0), size_(0), devices_(0), slots_(0)
+	{
+	} // FrameRing
+
+FrameRing::~FrameRing(void)
+	{
+	Close();
+	} // ~FrameRing
+
+bool FrameRing::Map(int fd, size_t size)
+	{
+	void * memory = mmap(0,size,PROT_READ | PROT_WRITE,MAP_SHARED,fd,0);
+	close(fd);
+	if (MAP_FAILED == memory)
+		return false;
+	base_   = static_cast<uint8*>(memory);
+	size_   = size;
+	header_ = reinterpret_cast<Header*>(base_);
+	return true;
+	} // Map
+
+// make a ring for devices gadgets, replacing any left behind
+bool FrameRing::Create(const string & name, int devices, int slots)
+	{
+	static_assert(sizeof(Slot) <= 2*LineSize, "frame slot too big");
+	static_assert(sizeof(Device) <= LineSize, "device line too big");
+	Close();
+	if ((devices <= 0) || (65535 < devices) || (slots <= 0) || (MaxSlots < slots))
+		return false;
+	shm_unlink(name.c_str());
+	int fd = shm_open(name.c_str(),O_RDWR | O_CREAT | O_EXCL,0666);
+	if (fd < 0)
+		return false;
+	size_t size = LineSize + static_cast<size_t>(devices)*DeviceStride(slots);
+	if (0 != ftruncate(fd,size))
+		{
+		close(fd);
+		shm_unlink(name.c_str());
+		return false;
+		}
+	if (false == Map(fd,size))
+		{
+		shm_unlink(name.c_str());
+		return false;
+		}
+	name_ = name;
+
+	// zero filled by ftruncate, so counts and sequences start at 0
+	header_->version_ = FormatVersion;
+	header_->devices_ = static_cast<uint16>(devices);
+	header_->slots_   = slots;
+	atomic_thread_fence(memory_order_release);
+	header_->magic_   = RingMagic;
+	devices_ = devices;
+	slots_   = slots;
+	return true;
+	} // Create
+
+// map a ring the driver made
+bool FrameRing::Open(const string & name)
+	{
+	Close();
+	int fd = shm_open(name.c_str(),O_RDWR,0);
+	if (fd < 0)
+		return false;
+	struct stat info;
+	if ((0 != fstat(fd,&info)) || (info.st_size < LineSize))
+		{
+		close(fd);
+		return false;
+		}
+	if (false == Map(fd,info.st_size))
+		return false;
+	// read the counts once and bound them before any size is worked out
+	// from them, since another process may write the header
+	uint32 devices = header_->devices_, slots = header_->slots_;
+	if ((RingMagic != header_->magic_) || (FormatVersion != header_->version_) ||
+		(0 == devices) || (0 == slots) || (MaxSlots < slots) ||
+		(size_ < LineSize + static_cast<size_t>(devices)*DeviceStride(slots)))
+		{
+		Close();
+		return false;
+		}
+	devices_ = static_cast<int>(devices);
+	slots_   = static_cast<int>(slots);
+	return true;
+	} // Open
+
+void FrameRing::Close(void)
+	{
+	if (0 != base_)
+		munmap(base_,size_);
+	if (false == name_.empty())
+		shm_unlink(name_.c_str());
+	header_ = 0;
+	base_   = 0;
+	size_   = 0;
+	devices_ = slots_ = 0;
+	name_.clear();
+	} // Close
+
+int FrameRing::Devices(void) const
+	{
+	return devices_;
+	} // Devices
+
+int FrameRing::Slots(void) const
+	{
+	return slots_;
+	} // Slots
+
+FrameRing::Device * FrameRing::DeviceAt(int device) const
+	{
+	if ((0 == header_) || (device < 0) || (devices_ <= device))
+		return 0;
+	return reinterpret_cast<Device*>(base_ + LineSize + static_cast<size_t>(device)*DeviceStride(slots_));
+	} // DeviceAt
+
+FrameRing::Slot * FrameRing::SlotAt(int device, uint64 index) const
+	{
+	uint8 * line = reinterpret_cast<uint8*>(DeviceAt(device)) + LineSize;
+	return reinterpret_cast<Slot*>(line + (index % slots_)*2*LineSize);
+	} // SlotAt
+
+// slot for the next frame, marked as being written
+uint8 * FrameRing::BeginWrite(int device)
+	{
+	Device * dev = DeviceAt(device);
+	if (0 == dev)
+		return 0;
+	Slot * slot = SlotAt(device,dev->published_.load(memory_order_relaxed));
+	slot->sequence_.fetch_add(1,memory_order_relaxed);
+	atomic_thread_fence(memory_order_release); // odd count is seen before any new byte
+	return slot->frame_;
+	} // BeginWrite
+
+// publish the slot BeginWrite gave
+void FrameRing::EndWrite(int device)
+	{
+	Device * dev = DeviceAt(device);
+	if (0 == dev)
+		return;
+	uint64 published = dev->published_.load(memory_order_relaxed);
+	SlotAt(device,published)->sequence_.fetch_add(1,memory_order_release);
+	dev->published_.store(published+1,memory_order_release);
+	} // EndWrite
+
+bool FrameRing::Write(int device, const uint8 * frame)
+	{
+	uint8 * slot = BeginWrite(device);
+	if (0 == slot)
+		return false;
+	memcpy(slot,frame,WireFrameSize);
+	EndWrite(device);
+	return true;
+	} // Write
+
+// newest frame published after seen, read in place
+const uint8 * FrameRing::Newest(int device, uint64 & seen, uint32 & sequence)
+	{
+	Device * dev = DeviceAt(device);
+	if (0 == dev)
+		return 0;
+	uint64 published = dev->published_.load(memory_order_acquire);
+	if (published == seen)
+		return 0;
+	seen = published;
+	Slot * slot = SlotAt(device,published-1);
+	sequence = slot->sequence_.load(memory_order_acquire);
+	if (sequence & 1)
+		return 0; // lapped, and being written again
+	return slot->frame_;
+	} // Newest
+
+// true if the slot Newest gave was not touched since
+bool FrameRing::Unchanged(int device, uint64 seen, uint32 sequence) const
+	{
+	if (0 == DeviceAt(device))
+		return false;
+	atomic_thread_fence(memory_order_acquire); // reads of the frame happen before this
+	return sequence == SlotAt(device,seen-1)->sequence_.load(memory_order_relaxed);
+	} // Unchanged
+
+// newest frame, encoded straight from its slot
+SharedWireFrame FrameRing::NewestEncoded(int device, uint64 & seen)
+	{
+	uint32 sequence;
+	uint64 before = seen;
+	const uint8 * frame = Newest(device,seen,sequence);
+	if (0 == frame)
+		{
+		if (before != seen) // a new frame, but its slot is being written again
+			DeviceAt(device)->torn_.fetch_add(1,memory_order_relaxed);
+		return SharedWireFrame();
+		}
+	SharedWireFrame wire = WireCache::EncodeShared(frame);
+	if (false == Unchanged(device,seen,sequence))
+		{ // torn, a newer frame is coming anyway
+		DeviceAt(device)->torn_.fetch_add(1,memory_order_relaxed);
+		return SharedWireFrame();
+		}
+	DeviceAt(device)->read_.fetch_add(1,memory_order_relaxed);
+	return wire;
+	} // NewestEncoded
+
+bool FrameRing::Counts(int device, uint64 & read, uint64 & torn) const
+	{
+	Device * dev = DeviceAt(device);
+	if (0 == dev)
+		return false;
+	read = dev->read_.load(memory_order_relaxed);
+	torn = dev->torn_.load(memory_order_relaxed);
+	return true;
+	} // Counts
+
+}; // namespace HypnoGadget
+
+// end - FrameRing.cpp
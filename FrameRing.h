@@ -0,0 +1,91 @@
+// HypnoCOMM - serial communications for the HypnoGadgets
+// www.HypnoCube.com, www.HypnoSquare.com
+// header for a shared memory ring of frames per gadget (Linux)
+#ifndef FRAMERING_H
+#define FRAMERING_H
+
+#include "defines.h"
+#include "WireCache.h"
+#include <atomic>
+#include <string>
+
+namespace HypnoGadget {
+
+/* Frames from renderers in other processes, with no copy or system call
+   per frame. The driver Creates a POSIX shared memory object holding, for
+   each device, a ring of 96 byte frame slots and a count of frames
+   published. A producer Opens it and writes each frame into the next slot;
+   the driver reads the newest slot where it lies, encoding the SetFrame
+   packets straight from it.
+
+   Each slot has a sequence counter, odd while it is being written, so a
+   reader that raced a producer lapping the ring sees the count change and
+   drops what it read. One producer per device; any number may share the
+   ring for different devices.
+*/
+class FrameRing
+	{
+public:
+	enum {
+		DefaultSlots = 8,
+		MaxSlots     = 4096, // a ring claiming more is not trusted
+		FormatVersion = 1
+		};
+
+	FrameRing(void);
+	~FrameRing(void);
+
+	// driver side: make a ring called name (such as "/hypnod.ring") for
+	// devices gadgets, replacing any left behind. Return false on failure
+	bool Create(const std::string & name, int devices, int slots = DefaultSlots);
+	// producer side: map a ring the driver made
+	bool Open(const std::string & name);
+	// unmap, and remove the name if this side made it
+	void Close(void);
+
+	bool IsOpen(void) const { return 0 != header_; }
+	int Devices(void) const;
+	int Slots(void) const;
+
+	// producer: fill the slot BeginWrite returns, then EndWrite publishes it
+	// as the newest frame for device. Write does both from an image
+	uint8 * BeginWrite(int device);
+	void EndWrite(int device);
+	bool Write(int device, const uint8 * frame);
+
+	// driver: newest frame for device if one was published after count
+	// seen, else 0. The slot may be overwritten while in use, so check it
+	// with Unchanged once done reading. seen becomes the newest count
+	const uint8 * Newest(int device, uint64 & seen, uint32 & sequence);
+	bool Unchanged(int device, uint64 seen, uint32 sequence) const;
+
+	// Newest, encoded as a SetFrame, or 0 if none or it was overwritten
+	SharedWireFrame NewestEncoded(int device, uint64 & seen);
+
+	// frames NewestEncoded took for device, and found torn by a producer
+	// lapping the ring. Kept in the ring, so producers can read them too
+	bool Counts(int device, uint64 & read, uint64 & torn) const;
+
+private:
+	struct Header;
+	struct Device;
+	struct Slot;
+
+	Header * header_;
+	uint8 * base_;      // mapped memory
+	size_t size_;
+	int devices_, slots_; // from the header once checked, as others may write it
+	std::string name_;  // to unlink, if Created here
+
+	Device * DeviceAt(int device) const;
+	Slot * SlotAt(int device, uint64 index) const;
+	bool Map(int fd, size_t size);
+
+	FrameRing(const FrameRing &);             // not copyable
+	FrameRing & operator=(const FrameRing &);
+	}; // class FrameRing
+
+}; // namespace HypnoGadget
+
+#endif // FRAMERING_H
+// end - FrameRing.h
@@ -5,15 +5,24 @@
 #include "Gadget.h"
 #include "Packet.h"
 #include "Command.h"
-#include "Options.h"
+#include "options.h"
+#include "WireCache.h"
+#include "Latency.h"
+#include "RateControl.h"
+#include "MetaCache.h"
+#include "OptionsCodec.h"
+#include "Timer.h"
+#include "WireRecorder.h"
+#include "ErrorCounters.h"
 #include <queue>
 #include <stdexcept>
-#include <map>
 #include <string>
 #include <sstream>
 #include <vector>
 #include <cassert>
 #include <deque>
+#include <cstring>
+#include <cstdio>
 
 using namespace std;
 using namespace HypnoGadget;
@@ -24,23 +33,6 @@ namespace {
 
 // interface for bytes to be passed back and forth to the Command functions
 
-static const char * errMsgs_[] = {
-     "0 = no error",
-     "1 = timeout - too long of a delay between packets.",
-     "2 = missing packet, followed by missing sequence number.",
-     "3 = invalid checksum.",
-     "4 = invalid type (2 and 3 defined for now).",
-     "5 = invalid sequence counter.",
-     "6 = missing SYNC - SYNC out of order (2 SYNC in a row, for example).",
-     "7 = invalid packet length.",
-     "8 = invalid command.",
-     "9 = invalid data (valid command).",
-    "10 = invalid ESC sequence - illegal byte after ESC byte.",
-    "11 = overflow - too much data was fed in with the packets.",
-    "12 = command not implemented (in case command deliberately not allowed).",
-    "13 = invalid login value."
-	};
-
 	}; // anonymous namespace
 
 
@@ -68,13 +60,35 @@ public:
 		obtainedFrame_  = false;
 		loginState_     = Disconnected;
 		challengeValue_ = 0xABADC0DE; // default value
-		lastInfoType_   = lastInfoIndex_ = 0;
+		infoWindow_     = 4;
+		enumerating_    = awaitingReady_ = false;
+		validating_     = saveMeta_ = false;
+		connectStart_   = readyNanos_ = 0;
+		memset(infoNext_,0,sizeof(infoNext_));
+		memset(infoDone_,0,sizeof(infoDone_));
+		infoResync_     = infoMismatch_ = false;
+		infoResyncSent_ = 0;
+		infoResyncs_    = 0;
 		optionsDirty_   = false;
+		optionsWriting_ = optionsWriteQueued_ = false;
+		optionsWriteCRC_ = 0;
+		optionsWriteSent_ = 0;
 		optionsLoaded_  = false;
 		byteMode_       = GadgetControl::ConsoleMode;
 		consoleSize_    = 10000; // default size
-		memset(&options_,0,sizeof(HypnoGadget::Options));
+		frameStart_     = 0;
+		frameCRC_       = 0;
+		frameAcked_     = true;
+		flipAckNanos_   = 0;
+		errorPackets_   = 0;
+		errorText_      = 0;
+		errorDetail_    = DetailNone;
+		errorCode_      = 0;
+		memset(&options_,0,sizeof(::Options));
+		memset(optionsDevice_,0,sizeof(optionsDevice_));
+		memset(optionsPending_,0,sizeof(optionsPending_));
 		PacketReset(&packetState_);
+		PacketReset(&replayState_);
 		};
 
 	struct VersionInfo
@@ -94,7 +108,7 @@ public:
 	// wrapper for packet data
 	bool PacketSendData(uint8 destination, const uint8 * data, uint16 length)
 		{ // todo - this needs locked?! but cannot lock here else error!
-		bool retval = HypnoGadget::PacketSendData(&packetState_, IOWriteByte, this, destination, data, length);
+		bool retval = ::PacketSendData(&packetState_, IOWriteByte, this, destination, data, length);
 		return retval;
 		}
 
@@ -103,7 +117,7 @@ public:
 	string consoleText_; // string holding console bytes
 	uint32 consoleSize_; // max number of bytes we allow in console string
 
-	HypnoGadget::Options options_; // local copy - todo - reset it?
+	::Options options_; // local copy - todo - reset it?
 
 	// frame
 	bool obtainedFrame_;    // is there a frame in the buffer?
@@ -154,6 +168,8 @@ void Login(uint32 val)
 	data[2] = static_cast<uint8>(val>>16);
 	data[3] = static_cast<uint8>(val>>8);
 	data[4] = static_cast<uint8>(val);
+	connectStart_ = MonotonicNanos(); // connect to ready is timed from here
+	readyNanos_   = 0;
 	PacketSendData(0, data, 5);
 	AddACKWatch(packetState_.packetEncodedCRC_,"Login",CommandLogin);
 	AddMessageToLog("Login sent");
@@ -176,15 +192,101 @@ void GetFrame(void)
 	AddMessageToLog("GetFrame sent");
 	}
 
+// the encoded command comes from the wire cache, so repeated
+// images go out with a single copy
 void SetFrame(const uint8 * buffer)
 	{
-	uint8 data[97];
-	data[0] = CommandSetFrame;
-	memcpy(data+1,buffer,96);
-	PacketSendData(0, data, 97);
+	const WireFrame & wire = wireCache_.Encode(buffer);
+	packetBytes_.insert(packetBytes_.end(),wire.bytes_.begin(),wire.bytes_.end());
+	FrameQueued(wire);
+	} // SetFrame
+
+// a frame encoded once for many gadgets: only a reference is queued,
+// and Update writes its bytes in turn with the rest
+void SetFrame(const SharedWireFrame & wire)
+	{
+	SharedBytes shared;
+	shared.at_   = packetBytes_.size();
+	shared.wire_ = wire;
+	sharedBytes_.push_back(shared);
+	FrameQueued(*wire);
+	} // SetFrame
+
+// watch for the ACK of a queued SetFrame
+void FrameQueued(const WireFrame & wire)
+	{
+	packetState_.packetEncodedCRC_ = wire.crc_[WirePacketCount-1];
 	AddACKWatch(packetState_.packetEncodedCRC_,"SetFrame",CommandSetFrame);
+	frameCRC_   = packetState_.packetEncodedCRC_;
+	frameAcked_ = false;
+	if (0 != frameStart_)
+		{ // time from FrameStart counts toward this frame
+		ackWatch_.back().start_ = frameStart_;
+		frameStart_ = 0;
+		}
+	rateControl_.FrameSent(MonotonicNanos());
 	AddMessageToLog("SetFrame sent");
-	} // SetFrame
+	} // FrameQueued
+
+// the last SetFrame is ACKed, so a FlipFrame shows it
+bool FrameAcked(void) const
+	{
+	return frameAcked_;
+	}
+uint64 GetFlipAckNanos(void) const
+	{
+	return flipAckNanos_;
+	}
+
+// frame latency, from FrameStart to the SetFrame ACK
+void FrameStart(void)
+	{
+	frameStart_ = MonotonicNanos();
+	}
+void GetLatency(LatencyStage stage, LatencyHistogram & histogram)
+	{
+	if ((0 <= stage) && (stage < LatencyStageCount))
+		histogram = latency_[stage];
+	}
+void ClearLatency(void)
+	{
+	for (int stage = 0; stage < LatencyStageCount; ++stage)
+		latency_[stage].Clear();
+	}
+void GetLatencyReport(string & text)
+	{
+	LatencyReport(latency_,text);
+	}
+
+// frame rate the gadget keeps up with
+uint32 GetFrameRate(void)
+	{
+	return rateControl_.Rate();
+	}
+void SetFrameRateLimits(uint32 minRate, uint32 maxRate)
+	{
+	rateControl_.SetLimits(minRate,maxRate);
+	}
+void GetFrameRateStats(RateStats & stats)
+	{
+	rateControl_.GetStats(stats);
+	}
+
+// size and statistics for the cache of encoded SetFrame commands
+void SetFrameCacheSize(uint32 size)
+	{
+	wireCache_.SetSize(size);
+	}
+void GetFrameCacheStats(WireCacheStats & stats)
+	{
+	wireCache_.GetStats(stats);
+	}
+
+// longest gap in a reply before its start is dropped
+void SetPacketTimeout(uint32 ms)
+	{
+	PacketSetTimeout(&packetState_,ms);
+	}
 
 void FlipFrame(void)
 	{
@@ -229,7 +331,10 @@ void SelectTran(uint8 trans)
 	}
 
 // send Options command, writing data if write = true
-// else requesting reading data
+// else requesting reading data.
+// Writes only go out if the options differ from what the gadget has, and
+// while one is waiting on its ACK later ones are held and sent as one.
+// The gadget is taken to have a write only once it is ACKed
 void Options(bool write)
 	{
 	if (false == write)
@@ -239,15 +344,82 @@ void Options(bool write)
 		}
 	else
 		{
-		uint8 data[sizeof(::Options)];
-		memcpy(data,&options_,sizeof(::Options));
+		uint8 data[OptionsWireSize];
+		OptionsEncode(options_,data);
 		data[0] = CommandOptions;
+		CheckOptions(MonotonicNanos());
+		if (true == optionsWriting_)
+			{ // compare against the write out, the gadget will have that
+			if (0 == memcmp(data,optionsPending_,sizeof(data)))
+				{ // back to what is out, nothing more to send
+				optionsWriteQueued_ = false;
+				AddMessageToLog("Options already sent, awaiting ACK");
+				}
+			else
+				{
+				optionsWriteQueued_ = true;
+				AddMessageToLog("Options held until last write ACKed");
+				}
+			return;
+			}
+		if (false == optionsDirty_)
+			{
+			AddMessageToLog("Options unchanged, not sent");
+			return;
+			}
 		PacketSendData(0, data, sizeof(data));
+		memcpy(optionsPending_,data,sizeof(optionsPending_));
+		optionsWriting_ = true;
+		optionsWriteCRC_ = packetState_.packetEncodedCRC_;
+		optionsWriteSent_ = MonotonicNanos();
 		}
 	AddACKWatch(packetState_.packetEncodedCRC_,"Options",CommandOptions);
 	AddMessageToLog("Options sent");
 	} // Options
 
+// an Options write was ACKed, send any write held behind it
+void OptionsWritten(void)
+	{
+	memcpy(optionsDevice_,optionsPending_,sizeof(optionsDevice_));
+	optionsWriting_ = false;
+	UpdateOptionsDirty();
+	if (true == optionsWriteQueued_)
+		{
+		optionsWriteQueued_ = false;
+		Options(true);
+		}
+	}
+
+// an Options write got an Error or no ACK. The gadget may not have it, so
+// the options stay dirty, and any write held behind it goes out
+void OptionsFailed(const char * why)
+	{
+	optionsWriting_ = false;
+	UpdateOptionsDirty();
+	AddMessageToLog(why);
+	if (true == optionsWriteQueued_)
+		{
+		optionsWriteQueued_ = false;
+		Options(true);
+		}
+	}
+
+// give up on the ACK of an Options write after OptionsAckNanos
+void CheckOptions(uint64 now)
+	{
+	if ((true == optionsWriting_) && (now - optionsWriteSent_ > OptionsAckNanos))
+		OptionsFailed("Options write not ACKed, still dirty");
+	}
+
+// compare the options against what the gadget has
+void UpdateOptionsDirty(void)
+	{
+	uint8 data[OptionsWireSize];
+	OptionsEncode(options_,data);
+	data[0] = CommandOptions;
+	optionsDirty_ = (0 != memcmp(data,optionsDevice_,sizeof(data)));
+	}
+
 void Version(void)
 	{
 	uint8 data[1]={CommandVersion};
@@ -256,19 +428,80 @@ void Version(void)
 	AddMessageToLog("Version sent");
 	}
 
+// ask for one Info item. Replies carry only the text, but the gadget
+// answers in order, so requests in flight are matched to replies by a FIFO
 void Info(uint8 type, uint8 index)
 	{
 	uint8 data[3]={CommandInfo,type,index};
 	PacketSendData(0, data, sizeof(data));
-	lastInfoType_ = type;   // getting this type
-	lastInfoIndex_ = index; // getting this index
-#if 0 // todo - remove
-	char temp[100];
-	sprintf(temp,"Info sent %d %d",type,index);
-	AddMessageToLog(temp);
-#else
+	InfoRequest request = {type, index, MonotonicNanos()};
+	infoPending_.push_back(request);
 	AddMessageToLog("Info sent");
-#endif
+	}
+
+/* A reply may have gone missing, dropped by the decoder, answered with an
+   Error, or never sent, and every reply after it would be matched to the
+   wrong request. Replies are dropped until the ACK of a Ping, which the
+   gadget sends after answering everything before it, then every request
+   not answered is asked again. A reply lost whole, with no error to show
+   for it, is only seen when the last request times out, by which time the
+   replies after it were stored against the wrong items, so then the lists
+   are read again from the start.
+*/
+void InfoLost(uint64 now, bool timedOut)
+	{
+	infoMismatch_ = true;
+	if (InfoResyncLimit <= infoResyncs_)
+		{ // the line is too poor, stop rather than loop
+		infoPending_.clear();
+		infoRetry_.clear();
+		infoResync_ = enumerating_ = validating_ = awaitingReady_ = saveMeta_ = false;
+		ErrorMessage("Error: Info replies lost, enumeration stopped");
+		return;
+		}
+	++infoResyncs_;
+	if ((true == timedOut) && (true == enumerating_))
+		{
+		infoRetry_.clear();
+		ClearInfo();
+		}
+	else
+		infoRetry_.insert(infoRetry_.end(),infoPending_.begin(),infoPending_.end());
+	infoPending_.clear();
+	infoResync_ = true;
+	infoResyncSent_ = now;
+	Ping();
+	AddMessageToLog("Info reply lost, resynchronizing");
+	} // InfoLost
+
+// the Ping came back behind every reply, ask again what was not answered
+void InfoResynced(void)
+	{
+	infoResync_ = false;
+	deque<InfoRequest> retry;
+	retry.swap(infoRetry_);
+	for (size_t pos = 0; pos < retry.size(); ++pos)
+		Info(retry[pos].type_,retry[pos].index_);
+	FillInfoWindow();
+	}
+
+// a packet error or Error reply while Info requests are out
+void InfoError(void)
+	{
+	if ((false == infoResync_) && (false == infoPending_.empty()))
+		InfoLost(MonotonicNanos(),false);
+	}
+
+// give up on the oldest request, or on the Ping, after InfoReplyNanos
+void CheckInfo(uint64 now)
+	{
+	if (true == infoResync_)
+		{
+		if (now - infoResyncSent_ > InfoReplyNanos)
+			InfoLost(now,false); // the Ping was lost, not a reply
+		}
+	else if ((false == infoPending_.empty()) && (now - infoPending_.front().sent_ > InfoReplyNanos))
+		InfoLost(now,true);
 	}
 
 void Ping(void)
@@ -287,75 +520,216 @@ void Reset(void)
 	AddMessageToLog("Reset sent");
 	} // Reset
 
-void Info(const string & msg)
+/* Read the device name, description and copyright, every visualization and
+   every transition, then the options. Up to infoWindow_ requests are kept in
+   flight instead of waiting on each reply. Visualizations and transitions are
+   asked for past the end of their lists until an empty reply marks the end,
+   so a few extra requests are the cost of not knowing the counts.
+*/
+// forget the lists and where reading them had got to
+void ClearInfo(void)
 	{
+	visualizationList_.clear();
+	transitionList_.clear();
+	for (int type = 0; type < InfoTypes; ++type)
+		{
+		infoNext_[type] = 0;
+		infoDone_[type] = false;
+		}
+	}
 
-#if 0 // todo - remove
-	char temp[100];
-	sprintf(temp,"Info msg %d %s",msg.length(),msg.c_str());
-	AddMessageToLog(temp);
-#endif
+void Enumerate(void)
+	{
+	ClearInfo();
+	awaitingReady_ = true;
+	readyNanos_  = 0;
+	infoRetry_.clear();
+	infoResync_ = infoMismatch_ = false;
+	infoResyncs_ = 0;
+	if (0 == connectStart_)
+		connectStart_ = MonotonicNanos();
+	if (false == metaPath_.empty())
+		{ // versions and name first, to see if the cache knows this gadget
+		validating_ = true;
+		Version();
+		Info(0,infoNext_[0]++);
+		return;
+		}
+	enumerating_ = true;
+	FillInfoWindow();
+	}
+
+// with versions and name in hand, use the cache or read the rest
+void ValidateMeta(void)
+	{
+	validating_ = false;
+	uint8 versions[6];
+	GetVersions(versions);
+	const DeviceMeta * meta = metaCache_.Find(metaIdentity_,deviceName_,versions);
+	if (0 == meta)
+		{ // new gadget or firmware, read it all and remember it
+		saveMeta_ = enumerating_ = true;
+		FillInfoWindow();
+		return;
+		}
+
+	deviceDescription_ = meta->description_;
+	copyright_ = meta->copyright_;
+	visualizationList_.resize(meta->visualizations_.size());
+	for (size_t pos = 0; pos < meta->visualizations_.size(); ++pos)
+		visualizationList_[pos].name_ = meta->visualizations_[pos];
+	transitionList_.resize(meta->transitions_.size());
+	for (size_t pos = 0; pos < meta->transitions_.size(); ++pos)
+		transitionList_[pos].name_ = meta->transitions_[pos];
+	AddMessageToLog("Metadata from cache");
+	// options change on the gadget, from here or its buttons, so they are
+	// always read, and the reply marks it ready
+	Options(false);
+	}
+
+// remember what Enumerate read, unless replies were lost on the way
+void SaveMeta(void)
+	{
+	saveMeta_ = false;
+	if (true == infoMismatch_)
+		{
+		AddMessageToLog("Metadata not cached, Info replies were lost");
+		return;
+		}
+	DeviceMeta meta;
+	meta.identity_ = metaIdentity_;
+	GetVersions(meta.versions_);
+	meta.name_ = deviceName_;
+	meta.description_ = deviceDescription_;
+	meta.copyright_ = copyright_;
+	for (size_t pos = 0; pos < visualizationList_.size(); ++pos)
+		meta.visualizations_.push_back(visualizationList_[pos].name_);
+	for (size_t pos = 0; pos < transitionList_.size(); ++pos)
+		meta.transitions_.push_back(transitionList_[pos].name_);
+	metaCache_.Store(meta);
+	if (false == metaCache_.Save(metaPath_))
+		ErrorMessage("Error: could not save metadata cache " + metaPath_);
+	}
+
+// all six version bytes, hardware, software, protocol
+void GetVersions(uint8 * versions) const
+	{
+	versions[0] = hardwareVersion_.major_;
+	versions[1] = hardwareVersion_.minor_;
+	versions[2] = softwareVersion_.major_;
+	versions[3] = softwareVersion_.minor_;
+	versions[4] = protocolVersion_.major_;
+	versions[5] = protocolVersion_.minor_;
+	}
+
+// keep gadget metadata in a file at path, for gadgets known by identity
+void SetMetaCache(const string & path, const string & identity)
+	{
+	metaPath_ = path;
+	metaIdentity_ = identity;
+	if (false == path.empty())
+		metaCache_.Load(path);
+	}
+
+// send requests until the window is full or nothing is left to ask
+void FillInfoWindow(void)
+	{
+	while ((true == enumerating_) && (infoPending_.size() < infoWindow_))
+		{
+		if (infoNext_[0] < DeviceInfoCount)
+			Info(0,infoNext_[0]++);
+		else if ((false == infoDone_[1]) && (infoNext_[1] < 255))
+			Info(1,infoNext_[1]++);
+		else if ((false == infoDone_[2]) && (infoNext_[2] < 255))
+			Info(2,infoNext_[2]++);
+		else
+			break;
+		}
+	if ((true == enumerating_) && (true == infoPending_.empty()))
+		{ // none left to read, let's get the options
+		enumerating_ = false;
+		Options(false);
+		}
+	}
 
-	switch (lastInfoType_)
+// store an item in its list by index
+template <typename Item> 
+void StoreInfo(vector<Item> & list, uint8 index, const string & msg)
+	{
+	if (list.size() <= index)
+		list.resize(index+1);
+	list[index].name_ = msg;
+	}
+
+// handle an Info reply
+void Info(const string & msg)
+	{
+	if (true == infoResync_)
+		{ // may belong to any request, it is asked again
+		AddMessageToLog("Info reply dropped while resynchronizing");
+		return;
+		}
+	if (true == infoPending_.empty())
+		{
+		Rejected(CommandInfo,"Error: Info received, none requested");
+		return;
+		}
+	InfoRequest request = infoPending_.front();
+	infoPending_.pop_front();
+
+	switch (request.type_)
 		{
 		case 0 :  // info about device
-			switch (lastInfoIndex_)
+			switch (request.index_)
 				{
 				case 0 : // name
 					deviceName_ = msg;
-					Info(0,1);
 					break;
 				case 1 : // description
 					deviceDescription_ = msg;
-					Info(0,2);
 					break;
 				case 2 : // copyright
 					copyright_ = msg;
-					Info(1,0); // read visualization items
 					break;
 				default :
-					ErrorMessage("Error: unsupported Info command index");
+					Rejected(CommandInfo,"Error: unsupported Info command index");
 					break;
-				break;
 				} // switch for Info about device
+			if ((true == validating_) && (0 == request.index_))
+				ValidateMeta();
 			break;
 		case 1 :  // visualization info
-			if (0 == lastInfoIndex_) // starting over
-				visualizationList_.clear();
-			if (0 == msg.length())
-				{ // no item, last request out of bounds, go to next info item
-				Info(2,0);
-				}
-			else
-				{ // add item, request next one
-				GadgetImpl::Visualization v;
-				v.name_ = msg;
-				visualizationList_.push_back(v);
-				Info(1,lastInfoIndex_+1);
-				}
-			break;
 		case 2 :  // transition info
-			if (0 == lastInfoIndex_) // starting over
-				transitionList_.clear();
 			if (0 == msg.length())
-				{ // no item, last request out of bounds, go to next info item
-				// none left to read, let's get the options
-				Options(false);
-				}
-			else
-				{ // add item, request next one
-				GadgetImpl::Transition t;
-				t.name_ = msg;
-				transitionList_.push_back(t);
-				Info(2,lastInfoIndex_+1);
+				infoDone_[request.type_] = true; // past the end, later requests are too
+			else if (false == infoDone_[request.type_])
+				{
+				if (1 == request.type_)
+					StoreInfo(visualizationList_,request.index_,msg);
+				else
+					StoreInfo(transitionList_,request.index_,msg);
 				}
 			break;
 		default:
-			ErrorMessage("Error: unsupported Info command index");
+			Rejected(CommandInfo,"Error: unsupported Info command index");
 			break;
 		}
+
+	FillInfoWindow();
 	} // Info
 
+// requests in flight while enumerating, 1 asks one at a time
+void SetInfoWindow(uint8 window)
+	{
+	infoWindow_ = (0 == window) ? 1 : window;
+	}
+
+// ns from Login to options read after Enumerate, 0 until then
+uint64 GetReadyNanos(void)
+	{
+	return readyNanos_;
+	}
+
 // get the count of items loaded
 uint8 GetCount(InfoType type)
 	{
@@ -380,7 +754,7 @@ void GetName(InfoType type, std::string & name, uint8 index)
 // Here is the ability to read and write options as a block
 // get/set a copy of the options stored in the class
 // to get them from the device, use the Options command
-bool GetOptions(HypnoGadget::Options & opts)
+bool GetOptions(::Options & opts)
 	{
 	// todo - this and many other places are not thread safe! things need locked on a finer level
 	// pick variables that need locked, and this thread and the calling one need BOTH locked
@@ -388,34 +762,69 @@ bool GetOptions(HypnoGadget::Options & opts)
 	return optionsLoaded_;
 	}
 
-void SetOptions(const HypnoGadget::Options & opts)
+// marks the options dirty if they differ from what the gadget has
+void SetOptions(const ::Options & opts)
 	{
 	options_ = opts;
+	UpdateOptionsDirty();
 	}
 
-// process commands being sent back and forth to the gadget
-// call fairly often
-// todo - rewrite this entire section - compartmentalize it
-void Update(void)
+// true if the options differ from what the gadget has
+bool OptionsDirty(void) const
 	{
+	return optionsDirty_;
+	}
 
-	// write any bytes out 
+// write any bytes out
+void WriteQueued(void)
+	{
 	Lock();
-	if (false == packetBytes_.empty())
-		{
-		gadgetIO_.WriteBytes(&packetBytes_[0],
-			static_cast<uint16>(packetBytes_.size()));
+	if ((false == packetBytes_.empty()) || (false == sharedBytes_.empty()))
+		{ // own bytes, with shared frames written in place between them
+		size_t pos = 0;
+		for (size_t index = 0; index < sharedBytes_.size(); ++index)
+			{
+			const SharedBytes & shared = sharedBytes_[index];
+			if (pos < shared.at_)
+				WriteOut(&packetBytes_[pos],
+					static_cast<uint16>(shared.at_ - pos));
+			pos = shared.at_;
+			WriteOut(&shared.wire_->bytes_[0],
+				static_cast<uint16>(shared.wire_->bytes_.size()));
+			}
+		if (pos < packetBytes_.size())
+			WriteOut(&packetBytes_[pos],
+				static_cast<uint16>(packetBytes_.size() - pos));
 		packetBytes_.resize(0);
+		sharedBytes_.clear();
+		WrittenACKWatch(MonotonicNanos());
 		}
 	Unlock();
+	}
 
-
+// process commands being sent back and forth to the gadget
+// call fairly often
+// todo - rewrite this entire section - compartmentalize it
+void Update(void)
+	{
+	WriteQueued();
 
 	uint8 buffer[64];
 	uint16 byteCount = 0, bytesUsed = 0;
 
 	// get any bytes that are ready from the connection, and process
 	byteCount = gadgetIO_.ReadBytes(buffer,64);
+	uint64 readNanos = MonotonicNanos();
+	uint32 readTicks = static_cast<uint32>(readNanos/1000000); // the decoder times out in ms
+	if (true == recorder_.Recording())
+		recorder_.Record(WireIn,buffer,byteCount,readNanos);
+	if (0 == byteCount)
+		{ // the line was quiet since the last bytes, a gap here is real
+		PacketIdle(&packetState_,readTicks);
+		DecodeError();
+		}
+	else // bytes may have waited on us, time between calls is no gap
+		PacketBytesArrived(&packetState_,readTicks);
 
 	while (bytesUsed < byteCount)
 		{
@@ -436,7 +845,7 @@ void Update(void)
 
 			// pass out any bytes read in
 			uint16 leftBytes;
-			leftBytes = PacketDecodeBytes(&packetState_, buffer + bytesUsed, byteCount - bytesUsed);
+			leftBytes = PacketDecodeBytes(&packetState_, buffer + bytesUsed, byteCount - bytesUsed, readTicks);
 			bytesUsed += (byteCount - bytesUsed) - leftBytes; // next location
 
 			// see if a packet is ready, returns true iff one is ready
@@ -451,16 +860,34 @@ void Update(void)
 				if (LoggedIn != GetState())
 					byteMode_ = ConsoleMode; // return to console mode 
 				}
-			if (PacketErrorNone != PacketGetError(&packetState_))
-				{
-				PacketError error = PacketGetError(&packetState_);
-				PacketClearError(&packetState_); // todo - handle better
-				ErrorMessage(string("PacketError ") + errMsgs_[error]);
-				}
+			DecodeError();
 			} // packet bytes
 		} // while bytes left to process
+
+	uint64 now = MonotonicNanos();
+	CheckInfo(now);
+	CheckOptions(now);
+
+	// replies handled above may have queued commands, such as the next Info
+	// or the Options read, so they go now rather than wait on the next call
+	WriteQueued();
+
+	rateControl_.Errors(PacketErrorCount(&packetState_) + errorPackets_, now);
 	} // Update
 
+// log and count an error from the packet decoder, if any
+void DecodeError(void)
+	{
+	if (PacketErrorNone != PacketGetError(&packetState_))
+		{
+		PacketError error = PacketGetError(&packetState_);
+		PacketClearError(&packetState_); // todo - handle better
+		errorCounters_.Decoded(static_cast<uint8>(error));
+		ErrorMessage("PacketError ",DetailErrorText,static_cast<uint8>(error));
+		InfoError(); // a reply may have been in what was dropped
+		}
+	}
+
 // read/write state of the gadget
 GadgetControl::LoginState GetState(void) const
 	{
@@ -495,6 +922,7 @@ void ProcessCommand(uint8 dest, const uint8 * data, uint16 length)
 		}
 	::CommandType type = static_cast<::CommandType>(*data++);
 	--length;
+	errorCounters_.Received(static_cast<uint8>(type));
 	switch (type)
 		{
 		// 0.3 protocol commands
@@ -510,14 +938,30 @@ void ProcessCommand(uint8 dest, const uint8 * data, uint16 length)
 			uint16 crc = *data;
 			crc <<= 8;
 			crc += *(data+1);
-			string text, msg;
-			if (true == RemoveACKWatch(crc,text,command))
-				msg = "Ack received: " + text;
+			string msg;
+			Ack ack;
+			if (true == RemoveACKWatch(crc,ack))
+				{
+				msg = "Ack received: " + ack.message_;
+				if (CommandSetFrame == ack.command_)
+					{
+					uint64 now = MonotonicNanos();
+					RecordLatency(ack,now);
+					rateControl_.FrameAcked(now - (0 == ack.written_ ? ack.start_ : ack.written_),now);
+					if ((crc == frameCRC_) && (false == WatchingACK(crc)))
+						frameAcked_ = true; // the last SetFrame, not an identical one before it
+					}
+				else if (CommandFlipFrame == ack.command_)
+					flipAckNanos_ = MonotonicNanos();
+				}
 			else
 				msg = "Ack received: UNKNOWN";
+			command = ack.command_;
 			AddMessageToLog(msg);
 			
-			if (CommandLogin == command)
+			if ((CommandOptions == command) && (true == optionsWriting_) && (crc == optionsWriteCRC_))
+				OptionsWritten();
+			else if (CommandLogin == command)
 				{
 				loginState_ = LoggedIn;
 				byteMode_ = PacketMode;
@@ -527,6 +971,8 @@ void ProcessCommand(uint8 dest, const uint8 * data, uint16 length)
 				loginState_ = LoggedOut;
 				byteMode_ = ConsoleMode;
 				}
+			else if ((CommandPing == command) && (true == infoResync_))
+				InfoResynced();
 			}
 			break;
 		case CommandVersion :
@@ -543,18 +989,25 @@ void ProcessCommand(uint8 dest, const uint8 * data, uint16 length)
 		case CommandError :
 			{
 			AddMessageToLog("Error received");
+			++errorPackets_;
+			InfoError(); // it may be the answer to an Info
+			if (true == optionsWriting_) // or to the Options write
+				OptionsFailed("Options write answered by an Error, still dirty");
 			if (length >= 1)
-				ErrorMessage(string("Error packet: ") + errMsgs_[*data++]);
+				{
+				errorCounters_.Reported(*data);
+				ErrorMessage("Error packet: ",DetailErrorText,*data++);
+				}
 			else
-				ErrorMessage("Error packet: ???");
+				Rejected(type,"Error packet: ???");
 			}
 			break;
 		// 0.4 protocol commands
 		case CommandFlipFrame :
-			ErrorMessage("Error: received illegal FlipFrame command");
+			Rejected(type,"Error: received illegal FlipFrame command");
 			break;
 		case CommandSetFrame :
-			ErrorMessage("Error: received illegal SetFrame command");
+			Rejected(type,"Error: received illegal SetFrame command");
 			break;
 
 		// 0.5 protocol commands
@@ -564,19 +1017,28 @@ void ProcessCommand(uint8 dest, const uint8 * data, uint16 length)
 			//        thus the +1 on length is correct, we also back up data
 			--data;
 			length++;
-			if (length != sizeof(::Options)) 
-				ErrorMessage("Error: Options received, wrong length");
+			if (length != OptionsWireSize) 
+				Rejected(type,"Error: Options received, wrong length");
 			else
 				{
 				// copy options if correct version - todo - make getter/setter for fields
 				if (OPTIONS_VERSION != (*(data+1)))
 					{
-					ErrorMessage("Error: Options received, wrong version");
+					Rejected(type,"Error: Options received, wrong version");
 					}
 				else
 					{
-					memcpy(&options_,data,sizeof(::Options));
+					OptionsDecode(data,length,options_);
+					memcpy(optionsDevice_,data,sizeof(optionsDevice_));
+					optionsDirty_  = false;
 					optionsLoaded_ = true;
+					if ((true == awaitingReady_) && (false == enumerating_))
+						{ // last step of Enumerate
+						awaitingReady_ = false;
+						readyNanos_ = MonotonicNanos() - connectStart_;
+						if (true == saveMeta_)
+							SaveMeta();
+						}
 					}
 				}
 			break;
@@ -594,12 +1056,12 @@ void ProcessCommand(uint8 dest, const uint8 * data, uint16 length)
 		case CommandMaxVisIndex :
 			AddMessageToLog("MaxVisIndex received");
 			if (1 != length)
-				ErrorMessage("Error: incorrect length");
+				Rejected(type,"Error: incorrect length");
 			break;
 		case CommandMaxTranIndex :
 			AddMessageToLog("MaxTranIndex received");
 			if (1 != length)
-				ErrorMessage("Error: incorrect length");
+				Rejected(type,"Error: incorrect length");
 			break;
 		case CommandGetFrame :
 			{
@@ -611,16 +1073,13 @@ void ProcessCommand(uint8 dest, const uint8 * data, uint16 length)
 				}
 			else
 				{
-				ErrorMessage("Error: incorrect length");
+				Rejected(type,"Error: incorrect length");
 				}
 			}			
 			break;
 		default :
-			{
-			stringstream errMsg;
-			errMsg << "Unknown packet type " << type;
-			ErrorMessage(errMsg.str());
-			}
+			errorCounters_.Rejected(static_cast<uint8>(type));
+			ErrorMessage("Unknown packet type ",DetailNumber,static_cast<uint8>(type));
 			break;
 		}
 	} // ProcessCommand
@@ -631,13 +1090,81 @@ void AddByte(uint8 byte)
 	packetBytes_.push_back(byte);
 	}
 
+// bytes to GadgetIO, and to the capture if recording
+void WriteOut(const uint8 * bytes, uint16 length)
+	{
+	gadgetIO_.WriteBytes(bytes,length);
+	if (true == recorder_.Recording())
+		recorder_.Record(WireOut,bytes,length,MonotonicNanos());
+	}
+
+// capture every byte in and out of GadgetIO to a file
+bool StartRecording(const string & path)
+	{
+	return recorder_.Start(path);
+	}
+void StopRecording(void)
+	{
+	recorder_.Stop();
+	}
+
+// replaying a capture: bytes that were written are decoded here and their
+// commands watched for ACKs, as if just sent, so replies are matched
+void ReplayWritten(const uint8 * bytes, uint16 length)
+	{
+	while (0 != length)
+		{
+		uint16 left = PacketDecodeBytes(&replayState_, bytes, length, static_cast<uint32>(MonotonicNanos()/1000000));
+		bytes += length - left;
+		length = left;
+		uint8 dest;
+		uint8 * data;
+		uint16 size;
+		if ((true == PacketGetData(&replayState_, &dest, &data, &size)) && (0 != size))
+			{
+			CommandType command = static_cast<CommandType>(data[0]);
+			ostringstream text;
+			text << "replayed command " << static_cast<int>(command);
+			AddACKWatch(PacketCRC(&replayState_,true),text.str(),command);
+			if (CommandLogin == command)
+				connectStart_ = MonotonicNanos();
+			}
+		if (PacketErrorNone != PacketGetError(&replayState_))
+			PacketClearError(&replayState_);
+		}
+	WrittenACKWatch(MonotonicNanos());
+	}
+
 // return true if there has been an error, get the last error message
 // resets error message
 bool Error(string & errMsg)
 	{
+	if (0 != errorText_)
+		{ // text for the last error is only built when asked for
+		errorMessage_ = errorText_;
+		if (DetailErrorText == errorDetail_)
+			errorMessage_ += ErrorText(errorCode_);
+		else if (DetailNumber == errorDetail_)
+			{
+			char number[4];
+			sprintf(number,"%u",errorCode_);
+			errorMessage_ += number;
+			}
+		errorText_ = 0;
+		}
 	errMsg = errorMessage_;
 	errorMessage_ = "";
 	return errMsg.size() > 0;
+	}
+
+// counts of errors and commands, atomic so no lock is needed
+void GetErrorCounts(ErrorCounts & counts) const
+	{
+	errorCounters_.Get(counts);
+	}
+void ClearErrorCounts(void)
+	{
+	errorCounters_.Clear();
 	}	   
 
 
@@ -683,6 +1210,14 @@ private:
 	LoginState loginState_;
 	vector<uint8> packetBytes_;
 
+	// shared frames queued, each to be written before packetBytes_[at_]
+	struct SharedBytes
+		{
+		size_t at_;
+		SharedWireFrame wire_;
+		};
+	vector<SharedBytes> sharedBytes_;
+
 	// todo - default challenge value, allow setting it
 	uint32 challengeValue_; 
 
@@ -696,26 +1231,101 @@ private:
 	// data written to go to the serial connection
 	deque<string> messages_;
 	string errorMessage_;
+	// the last error, kept as a literal and a code until Error asks for text
+	enum ErrorDetail {DetailNone, DetailErrorText, DetailNumber};
+	const char * errorText_;  // 0 when errorMessage_ holds the last error
+	ErrorDetail errorDetail_; // what follows the literal: ErrorText(errorCode_), or the code as a number
+	uint8 errorCode_;
+	ErrorCounters errorCounters_; // errors by code and commands by type
 
 	// way to check packets sent to find ACK for them
-	// ACK gives CRC16 and last byte counter for a command, 
-	// map CRC to pair of command string and CommandType
+	// ACK gives CRC16 and last byte counter for a command. Identical commands,
+	// such as a frame sent twice, share a CRC, so watches are kept in send
+	// order and an ACK takes the oldest with its CRC, the gadget answering in
+	// order. Watches not ACKed within AckExpireNanos are dropped.
+	// times are MonotonicNanos, for frame latency
 	typedef struct 
 		{
+		uint16 crc_;
 		string message_;
 		CommandType command_;
+		uint64 start_;   // frame started, or command sent if not a frame
+		uint64 encoded_; // command encoded
+		uint64 written_; // bytes handed to GadgetIO, 0 until then
 		} Ack;
-	map<uint16,Ack> ackMap_;
+	deque<Ack> ackWatch_; // oldest first
+	enum {AckExpireNanos = 2000000000}; // an ACK this late is not coming
+
+	// latency of each stage of a frame, and start of the frame being drawn
+	LatencyHistogram latency_[LatencyStageCount];
+	uint64 frameStart_;
+
+	// for presenting on several gadgets at once
+	uint16 frameCRC_;      // CRC of the last SetFrame
+	bool frameAcked_;      // and whether its ACK is back
+	uint64 flipAckNanos_;  // MonotonicNanos the last FlipFrame ACK came back
+
+	// picks the frame rate from ACK round trips and errors
+	RateController rateControl_;
+	uint32 errorPackets_; // Error commands from the gadget
 
 	/* unsorted threading case variables! TODO */
 
-	// what we are asking for with the Info command
-	uint8 lastInfoType_;
-	uint8 lastInfoIndex_;
+	// what we are asking for with the Info command, oldest first
+	enum {
+		InfoTypes       = 3, // device, visualization, transition
+		DeviceInfoCount = 3  // name, description, copyright
+		};
+	struct InfoRequest
+		{
+		uint8 type_, index_;
+		uint64 sent_; // MonotonicNanos
+		};
+	deque<InfoRequest> infoPending_;
+	deque<InfoRequest> infoRetry_; // to ask again once resynchronized
+	bool infoResync_;           // a reply was lost, waiting on the Ping behind the rest
+	bool infoMismatch_;         // a reply was lost this Enumerate, so do not cache it
+	uint64 infoResyncSent_;     // MonotonicNanos of that Ping
+	uint32 infoResyncs_;        // this Enumerate
+	enum {
+		InfoReplyNanos  = 1000000000, // a reply or the Ping later than this is lost
+		InfoResyncLimit = 8           // resyncs before Enumerate gives up
+		};
+	uint32 infoWindow_;         // max requests in flight when enumerating
+	bool enumerating_;          // Enumerate still sending requests
+	bool awaitingReady_;        // Enumerate waiting on the options
+	uint8 infoNext_[InfoTypes]; // next index to ask for
+	bool infoDone_[InfoTypes];  // empty reply seen, list complete
+	uint64 connectStart_;       // MonotonicNanos of Login
+	uint64 readyNanos_;         // Login to enumerated, 0 until then
+
+	// metadata of gadgets seen before, to skip most of Enumerate
+	MetaCache metaCache_;
+	string metaPath_;           // empty for no cache
+	string metaIdentity_;
+	bool validating_;           // Enumerate waiting on name to check the cache
+	bool saveMeta_;             // cache missed, store once enumerated
 
 	bool optionsLoaded_, optionsDirty_;
+	// options block as the gadget has it, to find changes. Options are
+	// compared and written whole, as the gadget takes them, rather than by
+	// a setter for each field
+	uint8 optionsDevice_[OptionsWireSize];
+	uint8 optionsPending_[OptionsWireSize]; // the write out, the gadget's once ACKed
+	bool optionsWriting_;     // write sent, ACK not yet back
+	bool optionsWriteQueued_; // write asked for while one was out
+	uint16 optionsWriteCRC_;  // CRC the write's ACK will carry
+	uint64 optionsWriteSent_; // MonotonicNanos of the write
+	enum {OptionsAckNanos = 1000000000}; // stop holding writes if no ACK by then
 	PacketHandlerState packetState_;
 
+	// encoded SetFrame commands, by image
+	WireCache wireCache_;
+
+	// capture of the bytes in and out, and decoder of written bytes on replay
+	WireRecorder recorder_;
+	PacketHandlerState replayState_;
+
 
 	GadgetLock & lock_;
 
@@ -723,28 +1333,61 @@ private:
 	/* local functions */
 
 
-// add item to watch
+// add item to watch, dropping watches too old to be ACKed
 void AddACKWatch(uint16 crc, const string & text, CommandType command)
 	{
+	uint64 now = MonotonicNanos();
+	while ((false == ackWatch_.empty()) && (now - ackWatch_.front().encoded_ > AckExpireNanos))
+		ackWatch_.pop_front();
 	Ack ack;
+	ack.crc_     = crc;
 	ack.message_ = text;
 	ack.command_ = command;
-	ackMap_[crc] = ack;
+	ack.start_   = ack.encoded_ = now;
+	ack.written_ = 0;
+	ackWatch_.push_back(ack);
+	}
+// removes the oldest item with the CRC and returns true if found, else
+// return false and an Ack with no message and CommandUnknown
+bool RemoveACKWatch(uint16 crc, Ack & found)
+	{
+	found.crc_     = crc;
+	found.message_ = "";
+	found.command_ = CommandUnknown;
+	found.start_   = found.encoded_ = found.written_ = 0;
+	for (deque<Ack>::iterator iter = ackWatch_.begin(); iter != ackWatch_.end(); ++iter)
+		if (crc == iter->crc_)
+			{ // remove it, and return true
+			found = *iter;
+			ackWatch_.erase(iter);
+			return true;
+			}
+	return false;
 	}
-// removes item and returns true if found, else return false and
-bool RemoveACKWatch(uint16 crc, string& text, CommandType & command)
+// true if a command with the CRC is still waiting on its ACK
+bool WatchingACK(uint16 crc) const
 	{
-	text = "";
-	command = CommandUnknown;
-	map<uint16,Ack>::iterator iter = ackMap_.find(crc);
-	if (ackMap_.end() == iter)
-		return false;
-	// remove it, and return true
-	Ack & ack = iter->second;
-	text = ack.message_;
-	command = ack.command_;
-	ackMap_.erase(iter);
-	return true;
+	for (deque<Ack>::const_iterator iter = ackWatch_.begin(); iter != ackWatch_.end(); ++iter)
+		if (crc == iter->crc_)
+			return true;
+	return false;
+	}
+// note the time watched commands were handed to GadgetIO. Those not yet
+// written are the newest, so only the end of the watch is walked
+void WrittenACKWatch(uint64 now)
+	{
+	for (deque<Ack>::reverse_iterator iter = ackWatch_.rbegin();
+		(iter != ackWatch_.rend()) && (0 == iter->written_); ++iter)
+		iter->written_ = now;
+	}
+// add a frame's stages to the histograms
+void RecordLatency(const Ack & ack, uint64 now)
+	{
+	uint64 written = (0 == ack.written_) ? now : ack.written_;
+	latency_[LatencyEncode].Record(ack.encoded_ - ack.start_);
+	latency_[LatencyQueue].Record(written - ack.encoded_);
+	latency_[LatencyAck].Record(now - written);
+	latency_[LatencyTotal].Record(now - ack.start_);
 	}
 
 // get, release lock for threading
@@ -770,6 +1413,21 @@ void AddMessageToLog(const std::string & msg)
 void ErrorMessage(const std::string & msg) 
 	{
 	errorMessage_ = msg;
+	errorText_ = 0;
+	}
+// no allocation, text is built by Error
+void ErrorMessage(const char * text, ErrorDetail detail = DetailNone, uint8 code = 0)
+	{
+	errorText_   = text;
+	errorDetail_ = detail;
+	errorCode_   = code;
+	}
+
+// a command from the gadget that could not be used
+void Rejected(uint8 command, const char * text)
+	{
+	errorCounters_.Rejected(command);
+	ErrorMessage(text);
 	}
 
 	}; // class GadgetImpl
@@ -831,6 +1489,13 @@ void GadgetControl::SetFrame(const uint8 * buffer)
 	Unlock();
 	} // SetFrame
 
+void GadgetControl::SetFrame(const SharedWireFrame & wire)
+	{
+	Lock();
+	pImpl_->SetFrame(wire);
+	Unlock();
+	} // SetFrame
+
 void GadgetControl::FlipFrame(void)
 	{
 	Lock();
@@ -883,13 +1548,46 @@ void GadgetControl::Version(void)
 	Unlock();
 	}
 
+// Info(0,0) starts reading everything, as it always has
 void GadgetControl::Info(uint8 type, uint8 index)
 	{
 	Lock();
-	pImpl_->Info(type,index);
+	if ((0 == type) && (0 == index))
+		pImpl_->Enumerate();
+	else
+		pImpl_->Info(type,index);
+	Unlock();
+	}
+
+void GadgetControl::Enumerate(void)
+	{
+	Lock();
+	pImpl_->Enumerate();
 	Unlock();
 	}
 
+void GadgetControl::SetMetaCache(const std::string & path, const std::string & identity)
+	{
+	Lock();
+	pImpl_->SetMetaCache(path,identity);
+	Unlock();
+	}
+
+void GadgetControl::SetInfoWindow(uint8 window)
+	{
+	Lock();
+	pImpl_->SetInfoWindow(window);
+	Unlock();
+	}
+
+uint64 GadgetControl::GetReadyNanos(void)
+	{
+	Lock();
+	uint64 nanos = pImpl_->GetReadyNanos();
+	Unlock();
+	return nanos;
+	}
+
 void GadgetControl::Ping(void)
 	{
 	Lock();
@@ -984,10 +1682,28 @@ bool GadgetControl::Error(string & errMsg)
 	return ret;
 	}	   
 
+// counters are atomic, so these do not take the lock
+void GadgetControl::GetErrorCounts(ErrorCounts & counts)
+	{
+	pImpl_->GetErrorCounts(counts);
+	}
+
+void GadgetControl::ClearErrorCounts(void)
+	{
+	pImpl_->ClearErrorCounts();
+	}
+
+void GadgetControl::GetErrorReport(string & text)
+	{
+	ErrorCounts counts;
+	pImpl_->GetErrorCounts(counts);
+	ErrorReport(counts,text);
+	}
+
 // Here is the ability to read and write options as a block
 // get/set a copy of the options stored in the class
 // to get them from the device, use the Options command
-bool GadgetControl::GetOptions(HypnoGadget::Options & opts)
+bool GadgetControl::GetOptions(::Options & opts)
 	{
 	Lock();
 	bool ret = pImpl_->GetOptions(opts);
@@ -995,7 +1711,15 @@ bool GadgetControl::GetOptions(HypnoGadget::Options & opts)
 	return ret;
 	}
 
-void GadgetControl::SetOptions(const HypnoGadget::Options & opts)
+bool GadgetControl::OptionsDirty(void)
+	{
+	Lock();
+	bool dirty = pImpl_->OptionsDirty();
+	Unlock();
+	return dirty;
+	}
+
+void GadgetControl::SetOptions(const ::Options & opts)
 	{
 	Lock();
 	pImpl_->SetOptions(opts);
@@ -1059,6 +1783,117 @@ bool GadgetControl::GetFrame(uint8 ** buffer, int & size)
 	return ret;
 	}
 
+// size and statistics for the cache of encoded SetFrame commands
+void GadgetControl::SetFrameCacheSize(uint32 size)
+	{
+	Lock();
+	pImpl_->SetFrameCacheSize(size);
+	Unlock();
+	}
+
+void GadgetControl::GetFrameCacheStats(WireCacheStats & stats)
+	{
+	Lock();
+	pImpl_->GetFrameCacheStats(stats);
+	Unlock();
+	}
+
+void GadgetControl::SetPacketTimeout(uint32 ms)
+	{
+	Lock();
+	pImpl_->SetPacketTimeout(ms);
+	Unlock();
+	}
+
+// frame latency from FrameStart to the SetFrame ACK, by stage
+void GadgetControl::FrameStart(void)
+	{
+	Lock();
+	pImpl_->FrameStart();
+	Unlock();
+	}
+
+// capture of every byte in and out of GadgetIO
+bool GadgetControl::StartRecording(const std::string & path)
+	{
+	Lock();
+	bool started = pImpl_->StartRecording(path);
+	Unlock();
+	return started;
+	}
+void GadgetControl::StopRecording(void)
+	{
+	Lock();
+	pImpl_->StopRecording();
+	Unlock();
+	}
+void GadgetControl::ReplayWritten(const uint8 * bytes, uint16 length)
+	{
+	Lock();
+	pImpl_->ReplayWritten(bytes,length);
+	Unlock();
+	}
+
+// for presenting on several gadgets at once
+bool GadgetControl::FrameAcked(void)
+	{
+	Lock();
+	bool acked = pImpl_->FrameAcked();
+	Unlock();
+	return acked;
+	}
+uint64 GadgetControl::GetFlipAckNanos(void)
+	{
+	Lock();
+	uint64 nanos = pImpl_->GetFlipAckNanos();
+	Unlock();
+	return nanos;
+	}
+
+void GadgetControl::GetLatency(LatencyStage stage, LatencyHistogram & histogram)
+	{
+	Lock();
+	pImpl_->GetLatency(stage,histogram);
+	Unlock();
+	}
+
+void GadgetControl::ClearLatency(void)
+	{
+	Lock();
+	pImpl_->ClearLatency();
+	Unlock();
+	}
+
+void GadgetControl::GetLatencyReport(std::string & text)
+	{
+	Lock();
+	pImpl_->GetLatencyReport(text);
+	Unlock();
+	}
+
+// frame rate the gadget keeps up with
+uint32 GadgetControl::GetFrameRate(void)
+	{
+	Lock();
+	uint32 rate = pImpl_->GetFrameRate();
+	Unlock();
+	return rate;
+	}
+
+void GadgetControl::SetFrameRateLimits(uint32 minRate, uint32 maxRate)
+	{
+	Lock();
+	pImpl_->SetFrameRateLimits(minRate,maxRate);
+	Unlock();
+	}
+
+void GadgetControl::GetFrameRateStats(RateStats & stats)
+	{
+	Lock();
+	pImpl_->GetFrameRateStats(stats);
+	Unlock();
+	}
+
 }; // namespace HypnoGadget
 
 // end - Gadget.cpp
\ No newline at end of file
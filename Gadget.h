@@ -6,7 +6,11 @@
 #define GADGET_H
 
 #include "defines.h"
-#include "Options.h"
+#include "options.h"
+#include "WireCache.h"
+#include "Latency.h"
+#include "RateControl.h"
+#include "ErrorCounters.h"
 #include <string>
 
 namespace HypnoGadget {
@@ -95,6 +99,13 @@ public:
 	// resets error message
 	bool Error(std::string & errMsg);
 
+	// every error counted by code, and commands from the gadget by type,
+	// without building any text. Counts may be read from any thread at any
+	// time, they do not wait on the lock
+	void GetErrorCounts(ErrorCounts & counts);
+	void ClearErrorCounts(void);
+	void GetErrorReport(std::string & text); // table of the counts not 0
+
 	// process commands being sent back and forth to the gadget
 	// call fairly often
 	// call on thread A, all other functions call from thread B.
@@ -105,6 +116,11 @@ public:
 	// to get them from the device, use the Options command
 	bool GetOptions(Options & opts); // return true if the options have been loaded internally
 	void SetOptions(const Options & opts);
+	// true if options set differ from those on the gadget. Options(true)
+	// only sends when dirty, and holds writes while one awaits its ACK. A
+	// write counts only once ACKed, so the options stay dirty until then,
+	// and after an Error or no ACK within a second
+	bool OptionsDirty(void);
 
 	// text info, available after appropriate Info commands sent
 	std::string GetDescription(void);
@@ -141,17 +157,74 @@ public:
 	void MaxTranIndex(void);
 	void SelectTran(uint8 trans);
 	void Version(void);
-	void Info(uint8 type, uint8 index);
+	void Info(uint8 type, uint8 index); // Info(0,0) is Enumerate
 	void Ping(void);
 	void Reset(void);
 	void Options(bool write);
 	void SetFrame(const uint8 * buffer);
+	void SetFrame(const SharedWireFrame & wire); // queues the bytes without a copy
 	void FlipFrame(void);
 
+	// read the device text, visualizations, transitions and options, keeping
+	// several Info requests in flight (default 4, 1 asks one at a time).
+	// A reply lost on the line is asked again, and what was read then is not
+	// kept in the meta cache. Ready time is ns from Login until the options
+	// arrive, 0 until then
+	void Enumerate(void);
+	// keep what Enumerate reads in a file, for gadgets known by identity
+	// (such as the port) plus name and versions. When the file knows the
+	// gadget, Enumerate only reads the versions and name to check it, then
+	// the options, which are never taken from the file
+	void SetMetaCache(const std::string & path, const std::string & identity);
+	void SetInfoWindow(uint8 window);
+	uint64 GetReadyNanos(void);
+
+	// encoded SetFrame commands are cached by image, so repeated images
+	// skip the CRC, packet and ESC work. Size is max images held (0 = off)
+	void SetFrameCacheSize(uint32 size);
+	void GetFrameCacheStats(WireCacheStats & stats);
+
+	// a reply left partly decoded is dropped with PacketErrorTimeout once an
+	// Update finds nothing waiting this many ms after its last bytes, 0 to
+	// wait forever. Only such quiet reads are judged, as bytes may sit in the
+	// port while Update is not called. A caller that polls slower than the
+	// timeout misses stalls that end between calls (the next SYNC recovers),
+	// so should use SetPacketTimeout(0) or a timeout longer than its poll
+	void SetPacketTimeout(uint32 ms);
+
+	// frame latency. Call FrameStart as drawing of a frame begins, then
+	// each SetFrame is timed from there through encoding, writing to
+	// GadgetIO, and the gadget ACKing it
+	void FrameStart(void);
+	void GetLatency(LatencyStage stage, LatencyHistogram & histogram);
+	void ClearLatency(void);
+	void GetLatencyReport(std::string & text); // table of all stages
+
+	// capture every byte in and out of GadgetIO, with times, to a file.
+	// Writing is done on a background thread
+	bool StartRecording(const std::string & path);
+	void StopRecording(void);
+	// replaying a capture: feed the bytes it read to GadgetIO, and the bytes
+	// it wrote here, so commands are watched for ACKs as if just sent
+	void ReplayWritten(const uint8 * bytes, uint16 length);
+
+	// to change several gadgets at the same instant, send each its SetFrame,
+	// then FlipFrame all of them once every FrameAcked is true. The flip ACK
+	// time is MonotonicNanos when the last FlipFrame ACK came back
+	bool FrameAcked(void);
+	uint64 GetFlipAckNanos(void);
+
+	// frames per second the gadget keeps up with, judged each second from
+	// SetFrame ACK round trips and packet errors. Limits default to 4-30,
+	// equal limits fix the rate
+	uint32 GetFrameRate(void);
+	void SetFrameRateLimits(uint32 minRate, uint32 maxRate);
+	void GetFrameRateStats(RateStats & stats);
+
 	class GadgetImpl;
 private:
 	GadgetImpl * pImpl_;
-	mutable GadgetLock & lock_;
+	GadgetLock & lock_;
 	
 	// get, release lock for threading
 	void Lock(void) const
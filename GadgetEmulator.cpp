@@ -0,0 +1,336 @@
+// HypnoCOMM - serial communications for the HypnoGadgets
+// www.HypnoCube.com, www.HypnoSquare.com
+// a software gadget, the device side of the protocol
+#include "GadgetEmulator.h"
+#include "Command.h"
+#include <cstring>
+
+using namespace std;
+
+namespace HypnoGadget {
+
+namespace {
+
+const char * const Visualizations[] = {"Rain","Plasma","Spiral","Fireworks","Life"};
+const char * const Transitions[]    = {"Fade","Wipe","Dissolve"};
+
+	}; // anonymous namespace
+
+EmulatorConfig::EmulatorConfig(void) :
+	baud_(38400), commandNanos_(200000), frameNanos_(800000),
+	inputBuffer_(256), overflow_(OverflowDrop), packetTimeout_(PacketTimeoutDefault),
+	name_("HypnoCube emulator"), description_("4x4x4 RGB cube in software"),
+	copyright_("www.HypnoCube.com"),
+	visualizations_(Visualizations,Visualizations+sizeof(Visualizations)/sizeof(Visualizations[0])),
+	transitions_(Transitions,Transitions+sizeof(Transitions)/sizeof(Transitions[0]))
+	{
+	hardware_[0] = 1; hardware_[1] = 0;
+	software_[0] = 1; software_[1] = 0;
+	protocol_[0] = 0; protocol_[1] = 9;
+	} // EmulatorConfig
+
+GadgetEmulator::GadgetEmulator(const EmulatorConfig & config) :
+	config_(config), byteNanos_(0), lineNext_(0), outputNext_(0), busyUntil_(0),
+	packetMode_(false), loggedIn_(false)
+	{
+	if (0 != config_.baud_)
+		byteNanos_ = 10000000000ULL/config_.baud_; // start, 8 data and stop bits
+	if (0 == config_.inputBuffer_)
+		config_.inputBuffer_ = 1;
+	PacketReset(&inState_);
+	PacketReset(&outState_);
+	PacketSetTimeout(&inState_,config_.packetTimeout_);
+	memset(back_,0,sizeof(back_));
+	memset(front_,0,sizeof(front_));
+	memset(options_,0,sizeof(options_));
+	options_[0] = CommandOptions;
+	options_[1] = OPTIONS_VERSION;
+	memset(&stats_,0,sizeof(stats_));
+	} // GadgetEmulator
+
+uint32 GadgetEmulator::Room(void) const
+	{
+	size_t held = line_.size(), limit = LineBytes;
+	if (OverflowBlock == config_.overflow_)
+		{ // flow control holds the host back once the gadget's buffer is full
+		held += input_.size();
+		limit = config_.inputBuffer_;
+		}
+	return (held < limit) ? static_cast<uint32>(limit - held) : 0;
+	} // Room
+
+// take bytes from the host, they arrive one byte time apart
+uint16 GadgetEmulator::Receive(const uint8 * bytes, uint16 length, uint64 now)
+	{
+	if (length > Room())
+		length = static_cast<uint16>(Room());
+	if (0 == length)
+		return 0;
+	if (true == line_.empty())
+		lineNext_ = ((lineNext_ > now) ? lineNext_ : now) + byteNanos_;
+	line_.insert(line_.end(),bytes,bytes+length);
+	stats_.bytesIn_ += length;
+	return length;
+	} // Receive
+
+uint64 GadgetEmulator::NextEvent(void) const
+	{
+	uint64 next = ~0ULL;
+	bool blocked = (OverflowBlock == config_.overflow_) && (input_.size() >= config_.inputBuffer_);
+	if ((false == line_.empty()) && (false == blocked))
+		next = lineNext_;
+	if (((false == reply_.empty()) || (false == input_.empty())) && (busyUntil_ < next))
+		next = busyUntil_;
+	if ((false == output_.empty()) && (outputNext_ < next))
+		next = outputNext_;
+	return next;
+	} // NextEvent
+
+// carry the line, the gadget and the reply line forward to now
+void GadgetEmulator::Run(uint64 now, vector<uint8> & out)
+	{
+	bool moved = true;
+	while (true == moved)
+		{
+		moved = false;
+
+		// bytes off the line into the input buffer
+		while ((false == line_.empty()) && (lineNext_ <= now))
+			{
+			if (input_.size() >= config_.inputBuffer_)
+				{
+				if (OverflowBlock == config_.overflow_)
+					{ // held until the gadget frees a byte, then a byte time to arrive
+					lineNext_ = ((busyUntil_ > now) ? busyUntil_ : now) + byteNanos_;
+					break;
+					}
+				++stats_.overflowed_;
+				}
+			else
+				{
+				input_.push_back(line_.front());
+				if (input_.size() > stats_.inputPeak_)
+					stats_.inputPeak_ = static_cast<uint32>(input_.size());
+				}
+			line_.pop_front();
+			if (false == line_.empty())
+				lineNext_ += byteNanos_;
+			moved = true;
+			}
+
+		// the command being carried out is done, its replies go on the line
+		if ((busyUntil_ <= now) && (false == reply_.empty()))
+			{
+			if (true == output_.empty())
+				outputNext_ = ((outputNext_ > busyUntil_) ? outputNext_ : busyUntil_) + byteNanos_;
+			output_.insert(output_.end(),reply_.begin(),reply_.end());
+			reply_.clear();
+			moved = true;
+			}
+
+		// take bytes from the input buffer until a command keeps the gadget busy
+		while ((busyUntil_ <= now) && (false == input_.empty()))
+			{
+			moved = true;
+			if (false == packetMode_)
+				{ // console mode, a SYNC starts a packet
+				if (PacketSYNC == input_.front())
+					packetMode_ = true;
+				else
+					{
+					input_.pop_front();
+					++stats_.consoleBytes_;
+					}
+				continue;
+				}
+
+			uint8 buffer[64];
+			uint16 count = 0;
+			while ((count < sizeof(buffer)) && (count < input_.size()))
+				{
+				buffer[count] = input_[count];
+				++count;
+				}
+			uint16 leftBytes = PacketDecodeBytes(&inState_,buffer,count,static_cast<uint32>(now/1000000));
+			input_.erase(input_.begin(),input_.begin() + (count - leftBytes));
+
+			uint8 dest;
+			uint8 * data;
+			uint16 length;
+			if (true == PacketGetData(&inState_,&dest,&data,&length))
+				{
+				Command(data,length,now);
+				if (false == loggedIn_)
+					packetMode_ = false; // back to console mode
+				}
+			if (PacketErrorNone != PacketGetError(&inState_))
+				{
+				PacketError error = PacketGetError(&inState_);
+				PacketClearError(&inState_);
+				Error(error);
+				busyUntil_ = now + config_.commandNanos_;
+				}
+			}
+
+		// replies off the line to the host
+		while ((false == output_.empty()) && (outputNext_ <= now))
+			{
+			out.push_back(output_.front());
+			output_.pop_front();
+			++stats_.bytesOut_;
+			if (false == output_.empty())
+				outputNext_ += byteNanos_;
+			moved = true;
+			}
+		}
+	} // Run
+
+// carry out one command, the gadget is busy until its replies go out
+void GadgetEmulator::Command(const uint8 * data, uint16 length, uint64 now)
+	{
+	++stats_.commands_;
+	busyUntil_ = now + config_.commandNanos_;
+	if (0 == length)
+		{
+		Error(PacketErrorLength);
+		return;
+		}
+	CommandType type = static_cast<CommandType>(data[0]);
+	if ((false == loggedIn_) && (CommandLogin != type))
+		{
+		Error(PacketErrorCommand);
+		return;
+		}
+
+	switch (type)
+		{
+		case CommandLogin :
+			loggedIn_ = true;
+			Ack();
+			break;
+		case CommandLogout :
+			Ack();
+			loggedIn_ = false;
+			break;
+		case CommandVersion :
+			{
+			uint8 reply[7] = {CommandVersion,
+				config_.hardware_[0], config_.hardware_[1],
+				config_.software_[0], config_.software_[1],
+				config_.protocol_[0], config_.protocol_[1]};
+			Reply(reply,sizeof(reply));
+			Ack();
+			}
+			break;
+		case CommandInfo :
+			if (3 != length)
+				Error(PacketErrorLength);
+			else
+				ReplyInfo(data[1],data[2]); // not ACKed, the reply is the answer
+			break;
+		case CommandOptions :
+			if (1 == length)
+				Reply(options_,sizeof(options_)); // the command is the first byte of the block
+			else if ((OptionsWireSize != length) || (OPTIONS_VERSION != data[1]))
+				{
+				Error(PacketErrorData);
+				return;
+				}
+			else
+				memcpy(options_,data,sizeof(options_));
+			Ack();
+			break;
+		case CommandSetFrame :
+			if (1 + sizeof(back_) != length)
+				{
+				Error(PacketErrorLength);
+				return;
+				}
+			memcpy(back_,data+1,sizeof(back_));
+			++stats_.frames_;
+			busyUntil_ += config_.frameNanos_;
+			Ack();
+			break;
+		case CommandFlipFrame :
+			memcpy(front_,back_,sizeof(front_));
+			++stats_.flips_;
+			Ack();
+			break;
+		case CommandGetFrame :
+			PacketSendCommand(&outState_,WriteByte,this,0,CommandGetFrame,front_,sizeof(front_));
+			Ack();
+			break;
+		case CommandMaxVisIndex :
+		case CommandMaxTranIndex :
+			{
+			size_t count = (CommandMaxVisIndex == type) ? config_.visualizations_.size() : config_.transitions_.size();
+			uint8 reply[2] = {static_cast<uint8>(type), static_cast<uint8>(0 == count ? 0 : count-1)};
+			Reply(reply,sizeof(reply));
+			Ack();
+			}
+			break;
+		case CommandPing :
+		case CommandReset :
+		case CommandSelectVis :
+		case CommandSelectTran :
+		case CommandSetRate :
+		case CommandCurrentItem :
+			Ack(); // accepted, nothing to show for it
+			break;
+		default :
+			Error(PacketErrorNotImpl);
+			break;
+		}
+	} // Command
+
+void GadgetEmulator::Reply(const uint8 * data, uint16 length)
+	{
+	PacketSendData(&outState_,WriteByte,this,0,data,length);
+	} // Reply
+
+// name of a device field, visualization or transition, empty past the end
+void GadgetEmulator::ReplyInfo(uint8 type, uint8 index)
+	{
+	string text;
+	if (0 == type)
+		{
+		if (0 == index)
+			text = config_.name_;
+		else if (1 == index)
+			text = config_.description_;
+		else if (2 == index)
+			text = config_.copyright_;
+		}
+	else if ((1 == type) && (index < config_.visualizations_.size()))
+		text = config_.visualizations_[index];
+	else if ((2 == type) && (index < config_.transitions_.size()))
+		text = config_.transitions_[index];
+	if (text.length() > 200)
+		text.resize(200);
+	PacketSendCommand(&outState_,WriteByte,this,0,CommandInfo,
+		reinterpret_cast<const uint8*>(text.c_str()),static_cast<uint16>(text.length()+1));
+	} // ReplyInfo
+
+// ACK the command just decoded, by the CRC of its last packet
+void GadgetEmulator::Ack(void)
+	{
+	uint16 crc = PacketCRC(&inState_,true);
+	uint8 reply[3] = {CommandAck, static_cast<uint8>(crc>>8), static_cast<uint8>(crc)};
+	Reply(reply,sizeof(reply));
+	} // Ack
+
+void GadgetEmulator::Error(PacketError error)
+	{
+	++stats_.errors_;
+	uint8 reply[2] = {CommandError, static_cast<uint8>(error)};
+	Reply(reply,sizeof(reply));
+	} // Error
+
+void GadgetEmulator::WriteByte(void * param, uint8 byte)
+	{
+	static_cast<GadgetEmulator*>(param)->reply_.push_back(byte);
+	} // WriteByte
+
+}; // namespace HypnoGadget
+
+// end - GadgetEmulator.cpp
@@ -0,0 +1,119 @@
+// HypnoCOMM - serial communications for the HypnoGadgets
+// www.HypnoCube.com, www.HypnoSquare.com
+// header for a software gadget, the device side of the protocol
+#ifndef GADGETEMULATOR_H
+#define GADGETEMULATOR_H
+
+#include "defines.h"
+#include "Packet.h"
+#include "OptionsCodec.h"
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace HypnoGadget {
+
+// what the gadget does with bytes that arrive when its input buffer is full
+enum EmulatorOverflow {
+	OverflowDrop,  // lose them, as the PIC does with its UART
+	OverflowBlock  // hold them on the line, as hardware flow control would
+	};
+
+// how the emulated gadget behaves, defaults are a HypnoCube on its serial port
+struct EmulatorConfig
+	{
+	EmulatorConfig(void);
+
+	uint32 baud_;           // line speed each way, 10 bits a byte, 0 for no limit
+	uint64 commandNanos_;   // time to carry out any command
+	uint64 frameNanos_;     // extra time for a SetFrame
+	uint32 inputBuffer_;    // bytes the gadget holds before overflow_
+	EmulatorOverflow overflow_;
+	uint32 packetTimeout_;  // ms between bytes of a command before it is dropped, 0 for none
+
+	std::string name_, description_, copyright_;     // Info type 0
+	std::vector<std::string> visualizations_;        // Info type 1
+	std::vector<std::string> transitions_;           // Info type 2
+	uint8 hardware_[2], software_[2], protocol_[2];  // Version, major then minor
+	};
+
+// counts of what the emulated gadget did
+struct EmulatorStats
+	{
+	uint64 bytesIn_, bytesOut_;  // over the line
+	uint64 consoleBytes_;        // ignored in console mode
+	uint64 overflowed_;          // dropped with the input buffer full
+	uint64 commands_, frames_, flips_;
+	uint64 errors_;              // Error replies sent
+	uint32 inputPeak_;           // most bytes held in the input buffer
+	};
+
+/* The device side of the protocol, in software, to load and time the host
+   code without a gadget. It starts in console mode, turns to packet mode on
+   a SYNC, and answers Login, Logout, Version, Info, Options, SetFrame,
+   FlipFrame and GetFrame as a gadget does, ACKing each command.
+
+   Time is only what the caller passes in, so a run is reproducible. Bytes
+   handed to Receive cross the line at the baud rate into an input buffer of
+   inputBuffer_ bytes; the gadget takes a command from it and is busy for
+   commandNanos_ (and frameNanos_ for a SetFrame) before replying, and the
+   reply crosses the line at the baud rate too. Call Run whenever NextEvent
+   comes due or bytes arrive.
+*/
+class GadgetEmulator
+	{
+public:
+	enum {
+		LineBytes = 4096  // taken by Receive and not yet arrived, like a UART driver buffer
+		};
+
+	GadgetEmulator(const EmulatorConfig & config);
+
+	// take bytes from the host at now, returns how many were taken, no more
+	// than Room. The rest stay with the caller, as a full port stops writes
+	uint16 Receive(const uint8 * bytes, uint16 length, uint64 now);
+	uint32 Room(void) const;
+
+	// carry everything forward to now, appending bytes for the host to out
+	void Run(uint64 now, std::vector<uint8> & out);
+
+	// time Run next has something to do, or ~0 if only Receive will start it
+	uint64 NextEvent(void) const;
+
+	bool LoggedIn(void) const { return loggedIn_; }
+	const uint8 * Frame(void) const { return front_; } // the image showing
+	void GetStats(EmulatorStats & stats) const { stats = stats_; }
+
+private:
+	EmulatorConfig config_;
+	uint64 byteNanos_;       // a byte on the line, 0 for no limit
+
+	std::deque<uint8> line_; // from the host, not yet arrived
+	uint64 lineNext_;        // when the front of line_ arrives
+	std::deque<uint8> input_;// the gadget's input buffer
+	std::deque<uint8> output_; // to the host, not yet sent
+	uint64 outputNext_;      // when the front of output_ is sent
+	std::vector<uint8> reply_; // replies to the command being carried out
+	uint64 busyUntil_;       // when that command is done
+
+	bool packetMode_, loggedIn_;
+	PacketHandlerState inState_, outState_;
+	uint8 back_[96], front_[96];
+	uint8 options_[OptionsWireSize];
+	EmulatorStats stats_;
+
+	void Command(const uint8 * data, uint16 length, uint64 now);
+	void Reply(const uint8 * data, uint16 length);
+	void ReplyInfo(uint8 type, uint8 index);
+	void Ack(void);
+	void Error(PacketError error);
+	static void WriteByte(void * param, uint8 byte);
+
+	GadgetEmulator(const GadgetEmulator &);             // not copyable
+	GadgetEmulator & operator=(const GadgetEmulator &);
+	}; // class GadgetEmulator
+
+}; // namespace HypnoGadget
+
+#endif // GADGETEMULATOR_H
+// end - GadgetEmulator.h
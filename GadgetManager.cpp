@@ -0,0 +1,625 @@
+// HypnoCOMM - serial communications for the HypnoGadgets
+// www.HypnoCube.com, www.HypnoSquare.com
+// driving many gadgets from one epoll event loop (Linux)
+#include "GadgetManager.h"
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cstring>
+
+using namespace std;
+
+namespace HypnoGadget {
+
+namespace {
+
+// everything runs on the one thread, so there is nothing to lock
+class ManagerLock : public GadgetLock
+	{
+public:
+	void Lock(void) {}
+	void Unlock(void) {}
+	};
+
+const uint64 WatchFlag      = 1ULL << 63;  // epoll data for a watch, else a device
+const uint64 LoginPollNanos = 100000000;   // check on logins this often
+const uint64 SilentNanos    = 2000000000;  // no bytes back this long after sending means lost
+const int    MaxEvents      = 64;
+const int    MaxReads       = 16;          // Update calls per readable event
+const uint64 LateNanos      = 2000000;     // frames later than this count as late
+
+	}; // anonymous namespace
+
+struct GadgetManager::Device
+	{
+	Device(GadgetDrawFunc draw, void * param, uint32 rate)
+		: gadget_(io_,lock_), draw_(draw), param_(param), fixedRate_(rate),
+		loginSent_(0), sentAt_(0), lastRead_(0), lastWritten_(0), reopenAt_(0),
+		logins_(0), late_(0), broadcasts_(0), broadcastSkipped_(0), disconnects_(0),
+		writeArmed_(false), reopen_(false)
+		{
+		}
+
+	SerialIO io_;
+	ManagerLock lock_;
+	GadgetControl gadget_;
+	FrameScheduler scheduler_;
+	GadgetDrawFunc draw_;
+	void * param_;
+	uint32 fixedRate_;  // 0 for the gadget's own choice
+	uint64 loginSent_;  // MonotonicNanos of the last Login
+	uint64 sentAt_;     // MonotonicNanos of the first write not answered yet, 0 if none
+	uint64 lastRead_;   // io_.BytesRead() at the last Settle
+	uint64 lastWritten_; // io_.BytesWritten() at the last Settle
+	uint64 reopenAt_;   // MonotonicNanos to try a dropped port again
+	uint32 logins_;
+	uint32 late_;       // frames drawn more than LateNanos after their deadline
+	uint32 broadcasts_; // Send, Broadcast and Present frames sent
+	uint32 broadcastSkipped_; // and skipped while the port was busy
+	uint32 disconnects_;
+	bool writeArmed_;   // polling for writable
+	bool reopen_;       // opened by name, so it can be opened again
+	}; // struct Device
+
+GadgetManager::GadgetManager(void) : running_(false), present_(PresentIdle), presentStart_(0)
+	{
+	epoll_ = epoll_create1(EPOLL_CLOEXEC);
+	ClearPresentStats();
+	} // GadgetManager
+
+GadgetManager::~GadgetManager(void)
+	{
+	for (int device = 0; device < Count(); ++device)
+		delete devices_[device];
+	if (epoll_ >= 0)
+		close(epoll_);
+	} // ~GadgetManager
+
+// open a port and start logging in
+int GadgetManager::Add(const string & port, GadgetDrawFunc draw, void * param, uint32 rate)
+	{
+	Device * device = new Device(draw,param,rate);
+	if (false == device->io_.Open(port))
+		{
+		delete device;
+		return -1;
+		}
+	device->reopen_ = true;
+	return Insert(device);
+	} // Add
+
+// add a gadget on an open descriptor that is not a serial port
+int GadgetManager::Attach(int fd, const string & name, GadgetDrawFunc draw, void * param, uint32 rate)
+	{
+	Device * device = new Device(draw,param,rate);
+	if (false == device->io_.Attach(fd,name))
+		{
+		delete device;
+		return -1;
+		}
+	return Insert(device);
+	} // Attach
+
+// register the port, log in, and schedule its first check
+int GadgetManager::Insert(Device * device)
+	{
+	int index = Count();
+	devices_.push_back(device);
+	if (false == Register(index))
+		{
+		devices_.pop_back();
+		delete device;
+		return -1;
+		}
+
+	uint64 now = MonotonicNanos();
+	if (0 != device->fixedRate_)
+		device->gadget_.SetFrameRateLimits(device->fixedRate_,device->fixedRate_);
+	LogIn(index,now);
+	deadlines_.push(Deadline(now + LoginPollNanos,index));
+	return index;
+	} // Insert
+
+// add its port to the epoll set, polling for readable
+bool GadgetManager::Register(int device)
+	{
+	Device * dev = devices_[device];
+	struct epoll_event event;
+	memset(&event,0,sizeof(event));
+	event.events = EPOLLIN;
+	event.data.u64 = device;
+	dev->writeArmed_ = false;
+	return (epoll_ >= 0) && (0 == epoll_ctl(epoll_,EPOLL_CTL_ADD,dev->io_.Descriptor(),&event));
+	} // Register
+
+void GadgetManager::LogIn(int device, uint64 now)
+	{
+	Device * dev = devices_[device];
+	dev->gadget_.Login();
+	dev->gadget_.Update(); // write it out
+	dev->loginSent_ = now;
+	++dev->logins_;
+	Settle(device);
+	} // LogIn
+
+// the port hung up or failed: take it out of the set so it cannot wake us
+// again, and log out so nothing is sent until it is back
+void GadgetManager::Disconnect(int device, uint64 now)
+	{
+	Device * dev = devices_[device];
+	epoll_ctl(epoll_,EPOLL_CTL_DEL,dev->io_.Descriptor(),0);
+	dev->io_.Close();
+	dev->gadget_.SetState(GadgetControl::LoggedOut);
+	dev->writeArmed_ = false;
+	dev->sentAt_     = 0;
+	dev->reopenAt_   = now + LoginRetryNanos;
+	++dev->disconnects_;
+	} // Disconnect
+
+// open a dropped port again, if it was opened by name and it is time
+bool GadgetManager::Reopen(int device, uint64 now)
+	{
+	Device * dev = devices_[device];
+	if ((false == dev->reopen_) || (now < dev->reopenAt_))
+		return false;
+	string name(dev->io_.Name()); // a copy, as Open sets the name
+	if ((true == dev->io_.Open(name)) && (true == Register(device)))
+		return true;
+	dev->io_.Close();
+	dev->reopenAt_ = now + LoginRetryNanos;
+	return false;
+	} // Reopen
+
+// log out and close a device
+void GadgetManager::Remove(int device)
+	{
+	if (false == Valid(device))
+		return;
+	Device * dev = devices_[device];
+	dev->gadget_.Logout();
+	dev->gadget_.Update();
+	dev->io_.Flush();
+	epoll_ctl(epoll_,EPOLL_CTL_DEL,dev->io_.Descriptor(),0);
+	delete dev;
+	devices_[device] = 0; // its deadline is dropped when it comes up
+	} // Remove
+
+bool GadgetManager::Valid(int device) const
+	{
+	return (0 <= device) && (device < Count()) && (0 != devices_[device]);
+	} // Valid
+
+GadgetControl & GadgetManager::Gadget(int device)
+	{
+	return devices_[device]->gadget_;
+	} // Gadget
+
+const string & GadgetManager::Name(int device) const
+	{
+	return devices_[device]->io_.Name();
+	} // Name
+
+// watch another descriptor in the same loop
+bool GadgetManager::AddWatch(int fd, uint32 events, GadgetWatchFunc func, void * param)
+	{
+	struct epoll_event event;
+	memset(&event,0,sizeof(event));
+	event.events = events;
+	event.data.u64 = WatchFlag | static_cast<uint32>(fd);
+	if ((epoll_ < 0) || (0 != epoll_ctl(epoll_,EPOLL_CTL_ADD,fd,&event)))
+		return false;
+	Watch watch = {func, param};
+	watches_[fd] = watch;
+	return true;
+	} // AddWatch
+
+void GadgetManager::RemoveWatch(int fd)
+	{
+	if (0 == watches_.erase(fd))
+		return;
+	epoll_ctl(epoll_,EPOLL_CTL_DEL,fd,0);
+	} // RemoveWatch
+
+// after any I/O on a port: drop it if it failed, else note whether it
+// answered what was sent, and poll for writable if bytes wait
+void GadgetManager::Settle(int device)
+	{
+	Device * dev = devices_[device];
+	if (true == dev->io_.Failed())
+		{
+		Disconnect(device,MonotonicNanos());
+		return;
+		}
+	if (dev->io_.BytesRead() != dev->lastRead_)
+		{ // heard from, which counts for all written so far
+		dev->lastRead_    = dev->io_.BytesRead();
+		dev->lastWritten_ = dev->io_.BytesWritten();
+		dev->sentAt_      = 0;
+		}
+	else if (dev->io_.BytesWritten() != dev->lastWritten_)
+		{
+		dev->lastWritten_ = dev->io_.BytesWritten();
+		if (0 == dev->sentAt_)
+			dev->sentAt_ = MonotonicNanos();
+		}
+	Arm(device);
+	} // Settle
+
+// poll for writable only while bytes wait, else every idle port would wake us
+void GadgetManager::Arm(int device)
+	{
+	Device * dev = devices_[device];
+	bool want = dev->io_.Pending();
+	if (want == dev->writeArmed_)
+		return;
+	struct epoll_event event;
+	memset(&event,0,sizeof(event));
+	event.events = EPOLLIN;
+	if (true == want)
+		event.events |= EPOLLOUT;
+	event.data.u64 = device;
+	epoll_ctl(epoll_,EPOLL_CTL_MOD,dev->io_.Descriptor(),&event);
+	dev->writeArmed_ = want;
+	} // Arm
+
+// port ready: send what waits, read and process what came
+void GadgetManager::Service(int device, uint32 events)
+	{
+	Device * dev = devices_[device];
+	if (events & EPOLLOUT)
+		dev->io_.Flush();
+	if (events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+		{ // Update reads a small block at a time, so go until the port is drained
+		int reads = 0;
+		do
+			dev->gadget_.Update();
+		while ((true == dev->io_.ReadFull()) && (++reads < MaxReads));
+		}
+	Settle(device);
+	if ((events & (EPOLLERR | EPOLLHUP)) && (0 <= dev->io_.Descriptor()))
+		Disconnect(device,MonotonicNanos()); // drained, else it would wake us forever
+	} // Service
+
+// frame deadline or login check reached
+void GadgetManager::Tick(int device, uint64 now)
+	{
+	Device * dev = devices_[device];
+	GadgetControl & gadget = dev->gadget_;
+
+	if (dev->io_.Descriptor() < 0)
+		{ // dropped; ports attached by descriptor stay that way
+		if (true == Reopen(device,now))
+			{
+			LogIn(device,now);
+			deadlines_.push(Deadline(now + LoginPollNanos,device));
+			}
+		else if (true == dev->reopen_)
+			deadlines_.push(Deadline(dev->reopenAt_,device));
+		return;
+		}
+
+	bool loggedIn = (GadgetControl::LoggedIn == gadget.GetState());
+	if ((true == loggedIn) && (0 != dev->sentAt_) && (now - dev->sentAt_ > SilentNanos))
+		{ // sent but nothing back, start over
+		gadget.SetState(GadgetControl::LoggedOut);
+		loggedIn = false;
+		}
+
+	if (false == loggedIn)
+		{
+		if (now - dev->loginSent_ >= LoginRetryNanos)
+			{
+			gadget.Login();
+			dev->loginSent_ = now;
+			++dev->logins_;
+			}
+		gadget.Update();
+		Settle(device);
+		// draw from the next whole period once in
+		dev->scheduler_.Start(gadget.GetFrameRate());
+		deadlines_.push(Deadline(now + LoginPollNanos,device));
+		return;
+		}
+
+	if (0 == dev->draw_)
+		{ // frames come from Broadcast, only watch the login
+		gadget.Update();
+		Settle(device);
+		deadlines_.push(Deadline(now + LoginPollNanos,device));
+		return;
+		}
+
+	if (true == dev->scheduler_.Wait(0))
+		{
+		if (dev->scheduler_.LastLate() > LateNanos)
+			++dev->late_;
+		dev->draw_(dev->param_,device,gadget);
+		gadget.Update(); // send it
+		dev->scheduler_.SetRate(gadget.GetFrameRate());
+		Settle(device);
+		}
+	deadlines_.push(Deadline(dev->scheduler_.Deadline(),device));
+	} // Tick
+
+// show an image on one gadget now, dropping it if the port is busy
+bool GadgetManager::Send(int device, const uint8 * frame)
+	{
+	if (false == Valid(device))
+		return false;
+	Device * dev = devices_[device];
+	if (GadgetControl::LoggedIn != dev->gadget_.GetState())
+		return false;
+	if (true == dev->io_.Pending())
+		{
+		++dev->broadcastSkipped_;
+		return false;
+		}
+	dev->gadget_.FrameStart();
+	dev->gadget_.SetFrame(frame);
+	dev->gadget_.FlipFrame();
+	dev->gadget_.Update(); // send it
+	++dev->broadcasts_;
+	Settle(device);
+	return true;
+	} // Send
+
+// show one image on every logged in gadget, encoded once
+int GadgetManager::Broadcast(const uint8 * frame)
+	{
+	SharedWireFrame wire = WireCache::EncodeShared(frame);
+	int sent = 0;
+	for (int device = 0; device < Count(); ++device)
+		{
+		Device * dev = devices_[device];
+		if ((0 == dev) || (GadgetControl::LoggedIn != dev->gadget_.GetState()))
+			continue;
+		if (true == dev->io_.Pending())
+			{ // the port has not taken the last frame yet
+			++dev->broadcastSkipped_;
+			continue;
+			}
+		dev->gadget_.FrameStart();
+		dev->gadget_.SetFrame(wire);
+		dev->gadget_.FlipFrame();
+		dev->gadget_.Update(); // send it
+		++dev->broadcasts_;
+		Settle(device);
+		++sent;
+		}
+	return sent;
+	} // Broadcast
+
+// show one image on every logged in gadget at the same instant:
+// SetFrame to all now, FlipFrame to all once every SetFrame is ACKed
+int GadgetManager::Present(const uint8 * frame)
+	{
+	if (PresentIdle != present_)
+		{
+		++presentStats_.busy_;
+		return -1;
+		}
+	SharedWireFrame wire = WireCache::EncodeShared(frame);
+	presentTargets_.clear();
+	for (int device = 0; device < Count(); ++device)
+		{
+		Device * dev = devices_[device];
+		if ((0 == dev) || (GadgetControl::LoggedIn != dev->gadget_.GetState()))
+			continue;
+		dev->gadget_.FrameStart();
+		dev->gadget_.SetFrame(wire);
+		dev->gadget_.Update(); // send it
+		Settle(device);
+		presentTargets_.push_back(device);
+		}
+	if (false == presentTargets_.empty())
+		{
+		present_      = PresentSending;
+		presentStart_ = MonotonicNanos();
+		}
+	return static_cast<int>(presentTargets_.size());
+	} // Present
+
+void GadgetManager::ClearPresentStats(void)
+	{
+	presentStats_.presents_ = presentStats_.busy_ = presentStats_.timeouts_ = 0;
+	presentStats_.ready_.Clear();
+	presentStats_.sendSkew_.Clear();
+	presentStats_.ackSkew_.Clear();
+	} // ClearPresentStats
+
+// FlipFrame every gadget in as tight a burst as possible: queue them all
+// first, then write them all
+void GadgetManager::Flip(uint64 now)
+	{
+	for (size_t pos = 0; pos < presentTargets_.size(); ++pos)
+		devices_[presentTargets_[pos]]->gadget_.FlipFrame();
+	uint64 first = MonotonicNanos();
+	for (size_t pos = 0; pos < presentTargets_.size(); ++pos)
+		{
+		int device = presentTargets_[pos];
+		devices_[device]->gadget_.Update();
+		++devices_[device]->broadcasts_;
+		Settle(device);
+		}
+	presentStats_.sendSkew_.Record(MonotonicNanos() - first);
+	present_      = PresentFlipping;
+	presentStart_ = now;
+	} // Flip
+
+// move a present on once every gadget has ACKed, or dropping those that
+// have not by PresentTimeoutNanos
+void GadgetManager::PresentStep(uint64 now)
+	{
+	bool timedOut = (now - presentStart_ > PresentTimeoutNanos);
+	size_t acked = 0;
+	for (size_t pos = 0; pos < presentTargets_.size(); ++pos)
+		{
+		int device = presentTargets_[pos];
+		if (false == Valid(device))
+			continue;
+		GadgetControl & gadget = devices_[device]->gadget_;
+		if (PresentSending == present_)
+			acked += (true == gadget.FrameAcked()) ? 1 : 0;
+		else
+			acked += (gadget.GetFlipAckNanos() >= presentStart_) ? 1 : 0;
+		}
+	if ((acked < presentTargets_.size()) && (false == timedOut))
+		return;
+
+	// keep only the gadgets that ACKed, noting those that timed out
+	vector<int> targets;
+	uint64 firstAck = ~0ULL, lastAck = 0;
+	for (size_t pos = 0; pos < presentTargets_.size(); ++pos)
+		{
+		int device = presentTargets_[pos];
+		if (false == Valid(device))
+			continue;
+		GadgetControl & gadget = devices_[device]->gadget_;
+		if (PresentSending == present_)
+			{
+			if (true == gadget.FrameAcked())
+				targets.push_back(device);
+			else
+				++presentStats_.timeouts_;
+			}
+		else if (gadget.GetFlipAckNanos() >= presentStart_)
+			{
+			uint64 ack = gadget.GetFlipAckNanos();
+			if (ack < firstAck)
+				firstAck = ack;
+			if (ack > lastAck)
+				lastAck = ack;
+			}
+		else
+			++presentStats_.timeouts_;
+		}
+
+	if (PresentSending == present_)
+		{
+		presentStats_.ready_.Record(now - presentStart_);
+		presentTargets_.swap(targets);
+		if (true == presentTargets_.empty())
+			present_ = PresentIdle;
+		else
+			Flip(now);
+		}
+	else
+		{
+		if (lastAck >= firstAck)
+			presentStats_.ackSkew_.Record(lastAck - firstAck);
+		++presentStats_.presents_;
+		present_ = PresentIdle;
+		presentTargets_.clear();
+		}
+	} // PresentStep
+
+// wait for ports, watches or frame deadlines, and service them all
+bool GadgetManager::Poll(int timeoutMs)
+	{
+	if (epoll_ < 0)
+		return false;
+
+	uint64 now = MonotonicNanos();
+	if (false == deadlines_.empty())
+		{ // round up so we never wake just before a deadline
+		uint64 wait = (deadlines_.top().first > now) ? deadlines_.top().first - now : 0;
+		int waitMs = static_cast<int>((wait + 999999)/1000000);
+		if ((timeoutMs < 0) || (waitMs < timeoutMs))
+			timeoutMs = waitMs;
+		}
+	if (PresentIdle != present_)
+		{ // wake in time to give up on missing ACKs
+		uint64 end  = presentStart_ + PresentTimeoutNanos;
+		int waitMs = static_cast<int>(((end > now) ? end - now + 999999 : 0)/1000000);
+		if ((timeoutMs < 0) || (waitMs < timeoutMs))
+			timeoutMs = waitMs;
+		}
+
+	struct epoll_event events[MaxEvents];
+	int count = epoll_wait(epoll_,events,MaxEvents,timeoutMs);
+	if ((count < 0) && (EINTR != errno))
+		return false;
+
+	for (int pos = 0; pos < count; ++pos)
+		{
+		uint64 data = events[pos].data.u64;
+		if (data & WatchFlag)
+			{
+			int fd = static_cast<int>(data & 0xFFFFFFFF);
+			map<int,Watch>::iterator iter = watches_.find(fd);
+			if (watches_.end() != iter)
+				iter->second.func_(iter->second.param_,fd,events[pos].events);
+			}
+		else if (true == Valid(static_cast<int>(data)))
+			Service(static_cast<int>(data),events[pos].events);
+		}
+
+	now = MonotonicNanos();
+	while ((false == deadlines_.empty()) && (deadlines_.top().first <= now))
+		{
+		int device = deadlines_.top().second;
+		deadlines_.pop();
+		if (true == Valid(device))
+			Tick(device,now);
+		}
+	// ACKs may have come in, or timed out
+	if (PresentIdle != present_)
+		PresentStep(MonotonicNanos());
+	return true;
+	} // Poll
+
+// Poll until Stop
+void GadgetManager::Run(void)
+	{
+	running_ = true;
+	while ((true == running_) && (true == Poll(-1)))
+		;
+	} // Run
+
+void GadgetManager::GetStats(int device, DeviceStats & stats) const
+	{
+	memset(&stats,0,sizeof(stats));
+	if (false == Valid(device))
+		return;
+	const Device * dev = devices_[device];
+	SchedulerStats scheduler;
+	dev->scheduler_.GetStats(scheduler);
+	stats.devices_      = 1;
+	stats.loggedIn_     = (GadgetControl::LoggedIn == dev->gadget_.GetState()) ? 1 : 0;
+	stats.logins_       = dev->logins_;
+	stats.frames_       = scheduler.ticks_ + dev->broadcasts_;
+	stats.late_         = dev->late_;
+	stats.skipped_      = scheduler.skipped_ + dev->broadcastSkipped_;
+	stats.rate_         = dev->scheduler_.GetRate();
+	stats.bytesRead_    = dev->io_.BytesRead();
+	stats.bytesWritten_ = dev->io_.BytesWritten();
+	stats.writeStalls_  = dev->io_.WriteStalls();
+	stats.connected_    = (dev->io_.Descriptor() >= 0) ? 1 : 0;
+	stats.disconnects_  = dev->disconnects_;
+	} // GetStats
+
+void GadgetManager::GetTotals(DeviceStats & stats) const
+	{
+	memset(&stats,0,sizeof(stats));
+	for (int device = 0; device < Count(); ++device)
+		{
+		DeviceStats one;
+		GetStats(device,one);
+		stats.devices_      += one.devices_;
+		stats.loggedIn_     += one.loggedIn_;
+		stats.logins_       += one.logins_;
+		stats.frames_       += one.frames_;
+		stats.late_         += one.late_;
+		stats.skipped_      += one.skipped_;
+		stats.rate_         += one.rate_;
+		stats.bytesRead_    += one.bytesRead_;
+		stats.bytesWritten_ += one.bytesWritten_;
+		stats.writeStalls_  += one.writeStalls_;
+		stats.connected_    += one.connected_;
+		stats.disconnects_  += one.disconnects_;
+		}
+	} // GetTotals
+
+}; // namespace HypnoGadget
+
+// end - GadgetManager.cpp
@@ -0,0 +1,174 @@
+// HypnoCOMM - serial communications for the HypnoGadgets
+// www.HypnoCube.com, www.HypnoSquare.com
+// header for driving many gadgets from one epoll event loop (Linux)
+#ifndef GADGETMANAGER_H
+#define GADGETMANAGER_H
+
+#include "Gadget.h"
+#include "SerialIO.h"
+#include "Timer.h"
+#include <string>
+#include <vector>
+#include <queue>
+#include <map>
+
+namespace HypnoGadget {
+
+// per gadget counts, and totals over all of them
+struct DeviceStats
+	{
+	uint32 devices_;      // 1 for a device, count for totals
+	uint32 loggedIn_;     // 1 if logged in, count for totals
+	uint32 logins_;       // login attempts
+	uint32 frames_;       // frames drawn or broadcast
+	uint32 late_;         // frames drawn over 2 ms after their deadline
+	uint32 skipped_;      // frames dropped to catch up or while busy
+	uint32 rate_;         // frames per second now, sum for totals
+	uint64 bytesRead_;
+	uint64 bytesWritten_;
+	uint32 writeStalls_;  // writes the port could not take at once
+	uint32 connected_;    // 1 if the port is open, count for totals
+	uint32 disconnects_;  // times the port hung up or failed
+	};
+
+// frames shown on every gadget at once with Present
+struct PresentStats
+	{
+	uint32 presents_;           // frames flipped
+	uint32 busy_;               // Present called while the last was still going
+	uint32 timeouts_;           // gadgets that missed a SetFrame or FlipFrame ACK
+	LatencyHistogram ready_;    // ns from Present until every SetFrame is ACKed
+	LatencyHistogram sendSkew_; // ns from the first FlipFrame written to the last
+	LatencyHistogram ackSkew_;  // ns from the first FlipFrame ACK to the last
+	};
+
+// draws a frame: fill in gadget SetFrame and FlipFrame calls
+typedef void (*GadgetDrawFunc)(void * param, int device, GadgetControl & gadget);
+
+// called when a watched descriptor is ready
+typedef void (*GadgetWatchFunc)(void * param, int fd, uint32 events);
+
+/* Owns any number of gadgets, each a GadgetControl on its own SerialIO,
+   and services them all from one thread. A single epoll set waits on every
+   port, plus any descriptors added with AddWatch; its timeout is the
+   nearest frame deadline, kept in a heap, so each gadget keeps its own
+   frame rate with no thread per port. Gadgets log in by themselves and log
+   in again if they stop answering. A port that hangs up or fails is taken
+   out of the set and, if it was opened by name, opened again every
+   LoginRetryNanos until it comes back.
+*/
+class GadgetManager
+	{
+public:
+	GadgetManager(void);
+	~GadgetManager(void);
+
+	// open a port and start logging in. Frames are drawn by draw at rate
+	// frames per second, or at the gadget's own choice for rate 0. Draw
+	// may be 0 for gadgets that only show what Broadcast sends.
+	// Return the device number, or -1 if the port would not open
+	int Add(const std::string & port, GadgetDrawFunc draw, void * param, uint32 rate = 0);
+
+	// add a gadget on an open descriptor that is not a serial port
+	int Attach(int fd, const std::string & name, GadgetDrawFunc draw, void * param, uint32 rate = 0);
+
+	// log out and close a device; its number is not reused
+	void Remove(int device);
+
+	int Count(void) const { return static_cast<int>(devices_.size()); }
+	bool Valid(int device) const;
+	GadgetControl & Gadget(int device);
+	const std::string & Name(int device) const;
+
+	// show an image on one gadget now, for frames from outside the loop.
+	// Return false if it is not logged in or its port is still writing
+	// the last frame, in which case the image is dropped
+	bool Send(int device, const uint8 * frame);
+
+	// show one image on every logged in gadget. It is encoded once and each
+	// port queues a reference to the same bytes, so a wall of gadgets costs
+	// little more than one. Gadgets still writing the last frame skip this
+	// one. Return the number of gadgets sent to
+	int Broadcast(const uint8 * frame);
+
+	// show one image on every logged in gadget at the same instant. The
+	// SetFrame goes to all of them, then once each has ACKed it the
+	// FlipFrames go out in one burst. Gadgets not ACKing within
+	// PresentTimeoutNanos are left out of the flip. Return the number of
+	// gadgets sent to, or -1 if the last Present is still going
+	int Present(const uint8 * frame);
+	bool Presenting(void) const { return PresentIdle != present_; }
+	void GetPresentStats(PresentStats & stats) const { stats = presentStats_; }
+	void ClearPresentStats(void);
+
+	// watch another descriptor in the same loop, for EPOLLIN and such events
+	bool AddWatch(int fd, uint32 events, GadgetWatchFunc func, void * param);
+	void RemoveWatch(int fd);
+
+	// wait up to timeoutMs (-1 forever) for ports, watches or frame
+	// deadlines, and service them all. Return false on an epoll error
+	bool Poll(int timeoutMs);
+
+	// Poll until Stop, which may be called from a watch or draw function
+	void Run(void);
+	void Stop(void) { running_ = false; }
+
+	void GetStats(int device, DeviceStats & stats) const;
+	void GetTotals(DeviceStats & stats) const;
+
+private:
+	enum {
+		LoginRetryNanos = 1000000000 // log in or open the port again if not in by then
+		};
+	enum {
+		PresentTimeoutNanos = 250000000 // wait this long for each Present ACK phase
+		};
+
+	struct Device;
+	std::vector<Device*> devices_; // 0 once removed
+
+	struct Watch
+		{
+		GadgetWatchFunc func_;
+		void * param_;
+		};
+	std::map<int,Watch> watches_;
+
+	// frame deadlines, soonest first
+	typedef std::pair<uint64,int> Deadline; // time, device
+	std::priority_queue<Deadline,std::vector<Deadline>,std::greater<Deadline> > deadlines_;
+
+	int epoll_;
+	bool running_;
+
+	// two phase present
+	enum PresentPhase {
+		PresentIdle,     // nothing going
+		PresentSending,  // SetFrames out, waiting for their ACKs
+		PresentFlipping  // FlipFrames out, waiting for their ACKs
+		};
+	PresentPhase present_;
+	std::vector<int> presentTargets_; // gadgets in this present
+	uint64 presentStart_;             // MonotonicNanos of this phase
+	PresentStats presentStats_;
+
+	int Insert(Device * device);
+	bool Register(int device);               // add its port to the epoll set
+	void LogIn(int device, uint64 now);      // send a Login
+	void Disconnect(int device, uint64 now); // drop a port that hung up or failed
+	bool Reopen(int device, uint64 now);     // try a dropped port again
+	void Service(int device, uint32 events); // port ready
+	void Tick(int device, uint64 now);       // frame deadline reached
+	void Settle(int device);                 // note what the port did after any I/O
+	void Arm(int device);                    // poll for writable only while bytes wait
+	void PresentStep(uint64 now);            // move a present on when ACKs are in
+	void Flip(uint64 now);                   // FlipFrame burst
+
+	GadgetManager(const GadgetManager &);             // not copyable
+	GadgetManager & operator=(const GadgetManager &);
+	}; // class GadgetManager
+
+}; // namespace HypnoGadget
+
+#endif // GADGETMANAGER_H
+// end - GadgetManager.h
@@ -0,0 +1,485 @@
+// hypnobench - times GadgetControl end to end against emulated gadgets
+// Linux, g++ -std=c++11
+
+// Each run makes a GadgetEmulator on a pseudo terminal, opens the other
+// side with SerialIO as a real port would be, logs in, enumerates, then
+// streams SetFrame and FlipFrame. Runs sweep the line speed, the share of
+// image bytes that must be escaped on the wire, and the frame rate asked
+// for; each prints the frames per second achieved, SetFrame ACK latency
+// percentiles, bytes written per frame and host CPU per frame. The host
+// CPU is only what GadgetControl and SerialIO take, not the emulator's.
+// In demo mode frames go out on every tick without waiting on ACKs, as
+// HypnoDemo sends them, and with rate 0 the tick follows the rate
+// controller; images repeated, as a clock repeats a frame until the time
+// it shows changes, then show whether the controller holds a steady rate.
+// With -j there are no gadgets: frames for many are rendered on a
+// RenderPool of each thread count, driven as GadgetManager's Draw would,
+// to show how rendering scales with the cores.
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "Gadget.h"         // the code being timed
+#include "SerialIO.h"       // its port
+#include "GadgetEmulator.h" // the gadget
+#include "Timer.h"          // pacing and timing
+#include "RenderPool.h"     // rendering across cores
+
+using namespace std;
+using namespace HypnoGadget;
+
+namespace {
+
+const uint64 ConnectNanos = 5000000000ULL; // give up on login and enumeration after this
+const uint64 AckLostNanos = 250000000ULL;  // stop waiting on a SetFrame ACK after this
+const int RenderDevices = 64;              // gadgets rendered for with -j
+
+// what one run is asked to do
+struct BenchPoint
+	{
+	uint32 baud_;
+	uint32 escapes_;  // percent of image bytes that are SYNC or ESC
+	uint32 rate_;     // frames per second, 0 for each frame as the last is ACKed
+	bool demo_;       // frames on every tick, not waiting on ACKs; rate 0 follows the controller
+	uint32 repeats_;  // times each image is sent in a row
+	};
+
+// what it did
+struct BenchResult
+	{
+	uint64 connectNanos_;  // Login to enumeration done
+	uint64 frames_, skipped_, lost_;
+	uint64 bytes_;         // written to the port while streaming
+	uint64 cpuNanos_;      // host thread CPU while streaming
+	double seconds_;
+	LatencyHistogram ack_;
+	RateStats rate_;       // the rate controller at the end
+	};
+
+	}; // anonymous namespace
+
+// one thread, so no locking
+class BenchLock : public GadgetLock
+	{
+public:
+	void Lock(void)
+		{
+		}
+	void Unlock(void)
+		{
+		}
+	}; // class BenchLock
+
+uint64 ThreadCpuNanos(void)
+	{
+	struct timespec now;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID,&now);
+	return static_cast<uint64>(now.tv_sec)*1000000000ULL + now.tv_nsec;
+	} // ThreadCpuNanos
+
+// a different image each frame, with escapes percent of bytes SYNC or ESC
+void MakeImage(uint32 & seed, uint32 escapes, uint8 * image)
+	{
+	for (int pos = 0; pos < 96; ++pos)
+		{
+		seed = seed*1664525 + 1013904223;
+		uint32 roll = seed >> 8;
+		if (roll % 100 < escapes)
+			image[pos] = (roll & 0x80) ? PacketSYNC : PacketESC;
+		else
+			{
+			image[pos] = static_cast<uint8>(roll >> 8);
+			if ((PacketSYNC == image[pos]) || (PacketESC == image[pos]))
+				++image[pos];
+			}
+		}
+	} // MakeImage
+
+// a plasma over the 64 LEDs, 4 bits a color, two to a byte, costing
+// about what a demo's frame does
+void RenderPlasma(void *, int device, uint64 tick, uint8 * frame)
+	{
+	double time = tick*0.05 + device;
+	for (int led = 0; led < 64; ++led)
+		{
+		double i = led & 3, j = (led >> 2) & 3, k = led >> 4;
+		double value = sin(i*0.7 + time) + sin(j*0.9 - time*1.3) + sin(k*1.1 + time*0.7) +
+			sin(sqrt(i*i + j*j + k*k) + time*0.5);
+		for (int c = 0; c < 3; ++c)
+			{ // the high nibble first, so it sets the byte the low one fills
+			uint8 color = static_cast<uint8>(7.5 + 7.5*sin(value*2.1 + c*2.094));
+			int nibble = led*3 + c;
+			uint8 & byte = frame[nibble >> 1];
+			byte = (nibble & 1) ? static_cast<uint8>((byte & 0xF0) | color) : static_cast<uint8>(color << 4);
+			}
+		}
+	} // RenderPlasma
+
+// render for RenderDevices gadgets on each thread count for seconds,
+// taking and submitting each device's frame in turn as Draw does
+void RenderBench(const vector<uint32> & threads, int seconds)
+	{
+	cout << " threads  frames/s  speedup  stolen%  busy%\n";
+	double first = 0;
+	for (size_t t = 0; t < threads.size(); ++t)
+		{
+		RenderPool pool(RenderPlasma,0,RenderDevices,static_cast<int>(threads[t]));
+		vector<uint64> next(RenderDevices,0);
+		uint64 submits = 0;
+		uint64 start = MonotonicNanos(), now = start;
+		while (now - start < seconds*1000000000ULL)
+			{
+			for (int device = 0; device < RenderDevices; ++device)
+				{
+				uint64 tick;
+				pool.Take(device,tick);
+				++submits;
+				if (true == pool.Submit(device,next[device]))
+					++next[device];
+				}
+			this_thread::yield(); // the I/O thread would wait on its ports here
+			now = MonotonicNanos();
+			}
+		RenderStats stats;
+		pool.GetStats(stats);
+		double rate = stats.rendered_*1e9/(now - start);
+		if (0 == t)
+			first = rate;
+		cout << setw(8) << stats.threads_ << setw(10) << fixed << setprecision(0) << rate
+			<< setw(9) << setprecision(2) << rate/first
+			<< setw(9) << setprecision(1) << 100.0*stats.stolen_/((0 == stats.rendered_) ? 1 : stats.rendered_)
+			<< setw(7) << 100.0*stats.busy_/((0 == submits) ? 1 : submits) << "\n";
+		}
+	} // RenderBench
+
+/* The emulated gadget and the host on the two sides of a pseudo terminal,
+   both driven from one loop. Host work is timed on the thread CPU clock.
+*/
+class Bench
+	{
+public:
+	Bench(const EmulatorConfig & config) : emulator_(config), master_(-1), gadget_(serial_,lock_), cpu_(0), queued_(false)
+		{
+		}
+	~Bench(void)
+		{
+		if (master_ >= 0)
+			close(master_);
+		}
+
+	bool Open(void)
+		{
+		master_ = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+		if ((master_ < 0) || (0 != grantpt(master_)) || (0 != unlockpt(master_)) || (0 == ptsname(master_)))
+			return false;
+		string path(ptsname(master_));
+		int slave = open(path.c_str(),O_RDWR | O_NOCTTY | O_NONBLOCK);
+		if (slave < 0)
+			return false;
+		struct termios config;
+		if ((0 != tcgetattr(slave,&config)) || (cfmakeraw(&config), 0 != tcsetattr(slave,TCSANOW,&config)))
+			{
+			close(slave);
+			return false;
+			}
+		return serial_.Attach(slave,path);
+		}
+
+	// run both sides, waiting until deadline at most for something to do
+	void Step(uint64 deadline)
+		{
+		// commands just queued go out before waiting, and if that read
+		// a reply there is no waiting, so the caller sees it
+		bool hosted = queued_;
+		if (true == hosted)
+			Host();
+		uint64 now = MonotonicNanos(), next = emulator_.NextEvent();
+		if ((deadline < next) || (true == hosted))
+			next = (true == hosted) ? now : deadline;
+		struct pollfd fds[2] = {
+			{master_, static_cast<short>((0 != emulator_.Room() ? POLLIN : 0) | (false == toHost_.empty() ? POLLOUT : 0)), 0},
+			{serial_.Descriptor(), static_cast<short>(POLLIN | (true == serial_.Pending() ? POLLOUT : 0)), 0}
+			};
+		uint64 wait = (next <= now) ? 0 : next - now;
+		struct timespec timeout = {static_cast<time_t>(wait/1000000000), static_cast<long>(wait%1000000000)};
+		ppoll(fds,2,&timeout,0);
+
+		// gadget side
+		now = MonotonicNanos();
+		if (0 != (fds[0].revents & POLLIN))
+			{
+			uint8 buffer[4096];
+			size_t room = emulator_.Room();
+			ssize_t got = read(master_,buffer,(room < sizeof(buffer)) ? room : sizeof(buffer));
+			if (got > 0)
+				emulator_.Receive(buffer,static_cast<uint16>(got),now);
+			}
+		emulator_.Run(now,toHost_);
+		if (false == toHost_.empty())
+			{
+			ssize_t written = write(master_,&toHost_[0],toHost_.size());
+			if (written > 0)
+				toHost_.erase(toHost_.begin(),toHost_.begin()+written);
+			}
+
+		if (0 != fds[1].revents)
+			Host(); // commands queued by the replies read go out before it returns
+		}
+
+	// read, process and write whatever the host has
+	void Host(void)
+		{
+		queued_ = false;
+		uint64 cpu = ThreadCpuNanos();
+		serial_.Flush();
+		gadget_.Update();
+		while (true == serial_.ReadFull())
+			gadget_.Update();
+		cpu_ += ThreadCpuNanos() - cpu;
+		}
+
+	// login and enumerate, false if the gadget did not get there in time
+	bool Connect(BenchResult & result)
+		{
+		uint64 start = MonotonicNanos(), end = start + ConnectNanos;
+		gadget_.Login();
+		queued_ = true;
+		while ((GadgetControl::LoggedIn != gadget_.GetState()) && (MonotonicNanos() < end))
+			Step(end);
+		if (GadgetControl::LoggedIn != gadget_.GetState())
+			return false;
+		gadget_.Enumerate();
+		queued_ = true;
+		while ((0 == gadget_.GetReadyNanos()) && (MonotonicNanos() < end))
+			Step(end);
+		result.connectNanos_ = MonotonicNanos() - start;
+		return 0 != gadget_.GetReadyNanos();
+		}
+
+	// frames at rate for seconds, each once the last is ACKed, or in demo
+	// mode on every tick
+	void Stream(const BenchPoint & point, uint32 seconds, BenchResult & result)
+		{
+		bool paced = (0 != point.rate_) || (true == point.demo_);
+		FrameScheduler scheduler;
+		if (0 != point.rate_)
+			scheduler.Start(point.rate_);
+		else if (true == point.demo_)
+			scheduler.Start(gadget_.GetFrameRate());
+		gadget_.ClearLatency();
+		uint32 seed = point.baud_ ^ (point.escapes_ << 24) ^ point.rate_;
+		uint8 image[96];
+		uint32 repeat = 0;
+		bool inFlight = false;
+		uint64 sentAt = 0;
+		uint64 bytes = serial_.BytesWritten();
+		cpu_ = 0;
+		uint64 start = MonotonicNanos(), end = start + seconds*1000000000ULL;
+		while (MonotonicNanos() < end)
+			{
+			bool due = (false == paced) || (true == scheduler.Wait(0));
+			if (true == point.demo_)
+				inFlight = false; // not waited on
+			if ((true == inFlight) && (true == gadget_.FrameAcked()))
+				inFlight = false;
+			if ((true == inFlight) && (MonotonicNanos() - sentAt > AckLostNanos))
+				{
+				++result.lost_;
+				inFlight = false;
+				}
+			if ((true == due) && (true == inFlight))
+				{
+				if (0 != point.rate_)
+					++result.skipped_; // the gadget has not taken the last one yet
+				}
+			else if (true == due)
+				{
+				if (0 == repeat)
+					MakeImage(seed,point.escapes_,image);
+				repeat = (repeat + 1) % point.repeats_;
+				uint64 cpu = ThreadCpuNanos();
+				gadget_.FrameStart();
+				gadget_.SetFrame(image);
+				gadget_.FlipFrame();
+				cpu_ += ThreadCpuNanos() - cpu;
+				queued_ = true;
+				sentAt = MonotonicNanos();
+				inFlight = true;
+				++result.frames_;
+				if ((true == point.demo_) && (0 == point.rate_))
+					scheduler.SetRate(gadget_.GetFrameRate());
+				}
+			uint64 deadline = (false == paced) ? end : scheduler.Deadline();
+			Step((deadline < end) ? deadline : end);
+			}
+		result.seconds_  = (MonotonicNanos() - start)/1e9;
+		result.bytes_    = serial_.BytesWritten() - bytes;
+		result.cpuNanos_ = cpu_;
+		gadget_.GetLatency(LatencyAck,result.ack_);
+		gadget_.GetFrameRateStats(result.rate_);
+		if (true == point.demo_) // frames not ACKed by the end
+			result.lost_ = result.frames_ - result.ack_.Count();
+		}
+
+private:
+	GadgetEmulator emulator_;
+	int master_;
+	vector<uint8> toHost_; // replies the pseudo terminal did not take yet
+	SerialIO serial_;
+	BenchLock lock_;
+	GadgetControl gadget_;
+	uint64 cpu_;
+	bool queued_;          // the host has commands to write
+
+	Bench(const Bench &);             // not copyable
+	Bench & operator=(const Bench &);
+	}; // class Bench
+
+// comma separated numbers
+bool ParseList(const string & text, vector<uint32> & values)
+	{
+	values.clear();
+	stringstream items(text);
+	string item;
+	while (getline(items,item,','))
+		{
+		if ((true == item.empty()) || (string::npos != item.find_first_not_of("0123456789")))
+			return false;
+		values.push_back(static_cast<uint32>(strtoul(item.c_str(),0,10)));
+		}
+	return false == values.empty();
+	} // ParseList
+
+// show the usage for the command line parameters
+void ShowUsage(const string & programName)
+	{
+	cerr << "Usage: " << programName << " [-b bauds] [-e percents] [-r rates] [-m ack|demo] [-s count] [-d seconds] [-c us] [-f us] [-i bytes] [-o drop|block]\n";
+	cerr << "       " << programName << " -j threads [-d seconds]\n";
+	cerr << " Streams frames to an emulated gadget for each combination of:\n";
+	cerr << " -b bauds     line speeds, 0 for no limit (default 38400,115200,0)\n";
+	cerr << " -e percents  image bytes needing escapes (default 0,10,50)\n";
+	cerr << " -r rates     frames per second, 0 for as fast as ACKed (default 30,60,0)\n";
+	cerr << " and for each:\n";
+	cerr << " -m mode      ack: one frame in flight (default), demo: a frame every tick,\n";
+	cerr << "              not waiting on ACKs, rate 0 following the rate controller\n";
+	cerr << " -s count     times each image is sent in a row (default 1)\n";
+	cerr << " -d seconds   streaming time (default 3)\n";
+	cerr << " -c us, -f us, -i bytes, -o mode   the gadget, as for hypnoemu\n";
+	cerr << " -j threads   instead render frames for " << RenderDevices << " gadgets on a RenderPool\n";
+	cerr << "              of each number of threads, 0 for one per core\n";
+	cerr << "Example: " << programName << " -b 115200 -e 0,25,50,100 -r 0 -d 5\n";
+	} // ShowUsage
+
+int main(int argc, char ** argv)
+	{
+	vector<uint32> bauds, escapes, rates, threads;
+	ParseList("38400,115200,0",bauds);
+	ParseList("0,10,50",escapes);
+	ParseList("30,60,0",rates);
+	EmulatorConfig config;
+	int seconds = 3;
+	bool demo = false;
+	uint32 repeats = 1;
+	for (int arg = 1; arg < argc; ++arg)
+		{
+		string text(argv[arg]);
+		if (arg+1 >= argc)
+			{
+			ShowUsage(argv[0]);
+			return -1;
+			}
+		string value(argv[++arg]);
+		bool ok = true;
+		if ("-b" == text)
+			ok = ParseList(value,bauds);
+		else if ("-e" == text)
+			ok = ParseList(value,escapes);
+		else if ("-r" == text)
+			ok = ParseList(value,rates);
+		else if (("-m" == text) && ("ack" == value))
+			demo = false;
+		else if (("-m" == text) && ("demo" == value))
+			demo = true;
+		else if ("-s" == text)
+			ok = 0 < (repeats = atoi(value.c_str()));
+		else if ("-j" == text)
+			ok = ParseList(value,threads);
+		else if ("-d" == text)
+			ok = 0 < (seconds = atoi(value.c_str()));
+		else if ("-c" == text)
+			config.commandNanos_ = strtoull(value.c_str(),0,10)*1000;
+		else if ("-f" == text)
+			config.frameNanos_ = strtoull(value.c_str(),0,10)*1000;
+		else if ("-i" == text)
+			ok = 0 < (config.inputBuffer_ = atoi(value.c_str()));
+		else if (("-o" == text) && ("drop" == value))
+			config.overflow_ = OverflowDrop;
+		else if (("-o" == text) && ("block" == value))
+			config.overflow_ = OverflowBlock;
+		else
+			ok = false;
+		if (false == ok)
+			{
+			ShowUsage(argv[0]);
+			return -1;
+			}
+		}
+
+	if (false == threads.empty())
+		{
+		RenderBench(threads,seconds);
+		return 0;
+		}
+
+	cout << "    baud  esc%  rate  connect ms      fps  skipped  lost  ack us p50    p90    p99  bytes/frame  cpu us/frame  rate  cuts\n";
+	for (size_t b = 0; b < bauds.size(); ++b)
+		for (size_t e = 0; e < escapes.size(); ++e)
+			for (size_t r = 0; r < rates.size(); ++r)
+				{
+				BenchPoint point = {bauds[b], (escapes[e] > 100) ? 100 : escapes[e], rates[r], demo, repeats};
+				config.baud_ = point.baud_;
+				BenchResult result;
+				result.connectNanos_ = result.frames_ = result.skipped_ = result.lost_ = 0;
+				result.bytes_ = result.cpuNanos_ = 0;
+				result.seconds_ = 0;
+
+				Bench bench(config);
+				if (false == bench.Open())
+					{
+					cerr << "Error making a pseudo terminal " << strerror(errno) << endl;
+					return -2;
+					}
+				cout << setw(8) << point.baud_ << setw(6) << point.escapes_ << setw(6) << point.rate_;
+				if (false == bench.Connect(result))
+					{
+					cout << "  gadget did not log in and enumerate\n";
+					continue;
+					}
+				bench.Stream(point,seconds,result);
+				uint64 frames = (0 == result.frames_) ? 1 : result.frames_;
+				cout << setw(12) << result.connectNanos_/1000000
+					<< setw(9) << fixed << setprecision(1) << result.frames_/result.seconds_
+					<< setw(9) << result.skipped_ << setw(6) << result.lost_
+					<< setw(12) << result.ack_.Percentile(50)/1000
+					<< setw(7) << result.ack_.Percentile(90)/1000
+					<< setw(7) << result.ack_.Percentile(99)/1000
+					<< setw(13) << result.bytes_/frames
+					<< setw(14) << setprecision(2) << result.cpuNanos_/1000.0/frames
+					<< setw(6) << result.rate_.rate_ << setw(6) << result.rate_.decreases_ << "\n";
+				}
+	return 0;
+	} // main
+
+// end - HypnoBench.cpp
@@ -0,0 +1,454 @@
+// hypnod - owns the HypnoGadgets and shows frames sent by local clients
+// Linux, g++ -std=c++11
+
+// Clients connect over a Unix domain socket or loopback TCP and send
+// batches of (device, image), see FrameProtocol.h. Renderers on the same
+// machine can instead write frames into a shared memory FrameRing, which
+// is read at each gadget's frame rate. Gadgets are logged in and kept
+// logged in here, so clients never do login or enumeration.
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "GadgetManager.h" // the gadgets, on one event loop
+#include "FrameProtocol.h" // what clients send
+#include "FrameRing.h"     // what co-located renderers write
+
+using namespace std;
+using namespace HypnoGadget;
+
+namespace {
+
+struct Client
+	{
+	vector<uint8> in_;      // bytes of a message not yet whole
+	deque<uint64> batches_; // batches not answered yet, oldest first
+	};
+
+// a batch is answered once none of its frames are still open
+struct Batch
+	{
+	uint32 sequence_;
+	int open_;        // frames waiting or sent but not ACKed
+	int shown_;       // frames ACKed
+	int replaced_;    // frames a newer one for the same gadget replaced
+	};
+
+// client frames for one gadget: one sent and waiting on its ACK, and
+// the newest behind it. Batch ids are 0 for none
+struct Outgoing
+	{
+	Outgoing(void) : sentBatch_(0), sentAt_(0), waitingBatch_(0) {}
+	uint64 sentBatch_;
+	uint64 sentAt_;        // MonotonicNanos it was sent
+	uint64 waitingBatch_;
+	vector<uint8> waiting_;
+	};
+
+enum FrameOutcome { FrameShown, FrameReplaced, FrameLost };
+
+struct Server
+	{
+	GadgetManager manager_;
+	int listen_;
+	string path_;                  // Unix socket to remove on exit, if any
+	map<int,Client> clients_;
+	map<uint64,Batch> batches_;    // by id, until answered
+	uint64 nextBatch_;
+	vector<Outgoing> outgoing_;    // per device
+	FrameRing ring_;               // shared memory frames, if asked for
+	vector<uint64> ringSeen_;      // frames taken from the ring per device
+	uint64 received_, frames_, shown_, replaced_, lost_;
+	};
+
+volatile sig_atomic_t stopping = 0;
+
+const uint64 ReportNanos = 10000000000ULL; // print counts this often
+const uint64 AckNanos    = 500000000;      // a frame not ACKed by then is lost
+
+	}; // anonymous namespace
+
+void OnSignal(int)
+	{
+	stopping = 1;
+	} // OnSignal
+
+// frame deadline: show the newest frame in the ring, encoded where it lies
+void RingDraw(void * param, int device, GadgetControl & gadget)
+	{
+	Server & server = *static_cast<Server*>(param);
+	SharedWireFrame wire = server.ring_.NewestEncoded(device,server.ringSeen_[device]);
+	if (0 == wire)
+		return;
+	gadget.FrameStart();
+	gadget.SetFrame(wire);
+	gadget.FlipFrame();
+	} // RingDraw
+
+void DropClient(Server & server, int fd)
+	{
+	// frames of its batches still go out, there is just no one to answer
+	deque<uint64> & batches = server.clients_[fd].batches_;
+	for (size_t pos = 0; pos < batches.size(); ++pos)
+		server.batches_.erase(batches[pos]);
+	server.manager_.RemoveWatch(fd);
+	server.clients_.erase(fd);
+	close(fd);
+	} // DropClient
+
+// one frame of a batch is done with
+void Settle(Server & server, uint64 id, FrameOutcome outcome)
+	{
+	if (FrameShown == outcome)
+		++server.shown_;
+	else if (FrameReplaced == outcome)
+		++server.replaced_;
+	else
+		++server.lost_;
+	map<uint64,Batch>::iterator iter = server.batches_.find(id);
+	if (server.batches_.end() == iter)
+		return; // its client is gone
+	Batch & batch = iter->second;
+	--batch.open_;
+	if (FrameShown == outcome)
+		++batch.shown_;
+	else if (FrameReplaced == outcome)
+		++batch.replaced_;
+	} // Settle
+
+// answer the client's batches that are done, in order. Return false if
+// the client is gone
+bool Answer(Server & server, int fd)
+	{
+	deque<uint64> & batches = server.clients_[fd].batches_;
+	while (false == batches.empty())
+		{
+		map<uint64,Batch>::iterator iter = server.batches_.find(batches.front());
+		if (0 != iter->second.open_)
+			break;
+		FrameHeader reply = {FrameReply, static_cast<uint8>(iter->second.shown_), FrameReplySize, iter->second.sequence_};
+		uint8 bytes[FrameHeaderSize + FrameReplySize];
+		FrameHeaderWrite(reply,bytes);
+		bytes[FrameHeaderSize] = static_cast<uint8>(iter->second.replaced_);
+		server.batches_.erase(iter);
+		batches.pop_front();
+		// replies are small, so a client whose socket is full is not reading them
+		if (sizeof(bytes) != send(fd,bytes,sizeof(bytes),MSG_NOSIGNAL | MSG_DONTWAIT))
+			return false;
+		}
+	return true;
+	} // Answer
+
+// move a gadget's client frames on: the sent one is shown once ACKed, or
+// lost if not by AckNanos or the gadget logged out, and then the waiting
+// one goes out. One at a time, so frames go at the rate the gadget ACKs
+void Advance(Server & server, int device, uint64 now)
+	{
+	Outgoing & out = server.outgoing_[device];
+	GadgetControl & gadget = server.manager_.Gadget(device);
+	bool loggedIn = (GadgetControl::LoggedIn == gadget.GetState());
+	if (0 != out.sentBatch_)
+		{
+		if (true == gadget.FrameAcked())
+			Settle(server,out.sentBatch_,FrameShown);
+		else if ((false == loggedIn) || (now - out.sentAt_ > AckNanos))
+			Settle(server,out.sentBatch_,FrameLost);
+		else
+			return;
+		out.sentBatch_ = 0;
+		}
+	if (0 == out.waitingBatch_)
+		return;
+	if (false == loggedIn)
+		Settle(server,out.waitingBatch_,FrameLost);
+	else if (true == server.manager_.Send(device,&out.waiting_[0]))
+		{
+		out.sentBatch_ = out.waitingBatch_;
+		out.sentAt_    = now;
+		}
+	else
+		return; // the port is still writing
+	out.waitingBatch_ = 0;
+	out.waiting_.clear();
+	} // Advance
+
+// after the gadgets were serviced: move every frame on, then answer the
+// batches that are done
+void SendPending(Server & server)
+	{
+	uint64 now = MonotonicNanos();
+	for (size_t device = 0; device < server.outgoing_.size(); ++device)
+		Advance(server,static_cast<int>(device),now);
+	vector<int> gone;
+	for (map<int,Client>::iterator iter = server.clients_.begin(); iter != server.clients_.end(); ++iter)
+		if (false == Answer(server,iter->first))
+			gone.push_back(iter->first);
+	for (size_t pos = 0; pos < gone.size(); ++pos)
+		DropClient(server,gone[pos]);
+	} // SendPending
+
+// queue what a batch holds, the newest frame per gadget winning, and send
+// what the ports take now. It is answered once all of it is shown or dropped
+void HandleBatch(Server & server, int fd, const FrameHeader & header, const uint8 * body)
+	{
+	uint64 id = server.nextBatch_++;
+	Batch & batch = server.batches_[id];
+	batch.sequence_ = header.sequence_;
+	batch.open_     = batch.shown_ = batch.replaced_ = 0;
+	server.clients_[fd].batches_.push_back(id);
+	++server.received_;
+
+	uint64 now = MonotonicNanos();
+	for (int entry = 0; entry < header.count_; ++entry)
+		{
+		const uint8 * bytes = body + entry*FrameEntrySize;
+		int device = bytes[0];
+		++server.frames_;
+		if ((false == server.manager_.Valid(device)) ||
+			(GadgetControl::LoggedIn != server.manager_.Gadget(device).GetState()))
+			{
+			++server.lost_;
+			continue;
+			}
+		Outgoing & out = server.outgoing_[device];
+		if (0 != out.waitingBatch_)
+			Settle(server,out.waitingBatch_,FrameReplaced); // the newer image wins
+		++batch.open_;
+		out.waitingBatch_ = id;
+		out.waiting_.assign(bytes+1,bytes+1+WireFrameSize);
+		Advance(server,device,now);
+		}
+	} // HandleBatch
+
+// read what a client sent, and handle each whole message
+void OnClient(void * param, int fd, uint32)
+	{
+	Server & server = *static_cast<Server*>(param);
+	Client & client = server.clients_[fd];
+	uint8 buffer[16384];
+	for (;;)
+		{
+		ssize_t count = recv(fd,buffer,sizeof(buffer),MSG_DONTWAIT);
+		if (0 == count)
+			{
+			DropClient(server,fd);
+			return;
+			}
+		if (count < 0)
+			{
+			if ((EAGAIN == errno) || (EWOULDBLOCK == errno))
+				break;
+			if (EINTR == errno)
+				continue;
+			DropClient(server,fd);
+			return;
+			}
+		client.in_.insert(client.in_.end(),buffer,buffer+count);
+		}
+
+	size_t used = 0;
+	while (client.in_.size() - used >= FrameHeaderSize)
+		{
+		FrameHeader header;
+		if ((false == FrameHeaderRead(&client.in_[used],header)) || (FrameBatch != header.type_))
+			{ // garbage, no way to find the next message
+			cerr << "Bad message from client " << fd << "\n";
+			DropClient(server,fd);
+			return;
+			}
+		if (client.in_.size() - used < static_cast<size_t>(FrameHeaderSize + header.length_))
+			break; // rest still coming
+		HandleBatch(server,fd,header,&client.in_[used + FrameHeaderSize]);
+		used += FrameHeaderSize + header.length_;
+		}
+	client.in_.erase(client.in_.begin(),client.in_.begin()+used);
+	if (false == Answer(server,fd)) // batches all for gadgets not logged in
+		DropClient(server,fd);
+	} // OnClient
+
+// a client connects: tell it how many devices there are
+void OnAccept(void * param, int fd, uint32)
+	{
+	Server & server = *static_cast<Server*>(param);
+	int client = accept4(fd,0,0,SOCK_NONBLOCK | SOCK_CLOEXEC);
+	if (client < 0)
+		return;
+	int one = 1;
+	setsockopt(client,IPPROTO_TCP,TCP_NODELAY,&one,sizeof(one)); // fails harmlessly on Unix sockets
+
+	FrameHeader hello = {FrameHello, static_cast<uint8>(server.manager_.Count()), 0, 0};
+	uint8 bytes[FrameHeaderSize];
+	FrameHeaderWrite(hello,bytes);
+	if ((FrameHeaderSize != send(client,bytes,FrameHeaderSize,MSG_NOSIGNAL)) ||
+		(false == server.manager_.AddWatch(client,EPOLLIN,OnClient,&server)))
+		{
+		close(client);
+		return;
+		}
+	server.clients_[client] = Client();
+	} // OnAccept
+
+// listen on a Unix socket at path, or loopback TCP port if path is empty
+bool Listen(Server & server, const string & path, int port)
+	{
+	if (true == path.empty())
+		{
+		server.listen_ = socket(AF_INET,SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,0);
+		if (server.listen_ < 0)
+			return false;
+		int one = 1;
+		setsockopt(server.listen_,SOL_SOCKET,SO_REUSEADDR,&one,sizeof(one));
+		struct sockaddr_in address;
+		memset(&address,0,sizeof(address));
+		address.sin_family      = AF_INET;
+		address.sin_port        = htons(static_cast<uint16>(port));
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // local clients only
+		if (0 != bind(server.listen_,reinterpret_cast<struct sockaddr*>(&address),sizeof(address)))
+			return false;
+		}
+	else
+		{
+		server.listen_ = socket(AF_UNIX,SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,0);
+		if (server.listen_ < 0)
+			return false;
+		struct sockaddr_un address;
+		memset(&address,0,sizeof(address));
+		address.sun_family = AF_UNIX;
+		if (path.size() >= sizeof(address.sun_path))
+			return false;
+		strcpy(address.sun_path,path.c_str());
+		unlink(path.c_str()); // left over from a run that did not clean up
+		if (0 != bind(server.listen_,reinterpret_cast<struct sockaddr*>(&address),sizeof(address)))
+			return false;
+		server.path_ = path;
+		}
+	if (0 != listen(server.listen_,64))
+		return false;
+	return server.manager_.AddWatch(server.listen_,EPOLLIN,OnAccept,&server);
+	} // Listen
+
+void Report(const Server & server)
+	{
+	DeviceStats totals;
+	server.manager_.GetTotals(totals);
+	cout << totals.loggedIn_ << "/" << totals.devices_ << " gadgets in, "
+		<< totals.disconnects_ << " disconnects, "
+		<< server.clients_.size() << " clients, "
+		<< server.received_ << " batches, " << server.frames_ << " frames, "
+		<< server.shown_ << " shown, " << server.replaced_ << " replaced, "
+		<< server.lost_ << " lost, " << totals.frames_ << " sent" << endl;
+	} // Report
+
+// show the usage for the command line parameters
+void ShowUsage(const string & programName)
+	{
+	cerr << "Usage: " << programName << " [-s path | -t port] [-r ring] device...\n";
+	cerr << " Owns the gadgets on the given serial ports, numbered from 0, and\n";
+	cerr << " shows frames local clients send.\n";
+	cerr << " -s path  Unix domain socket to listen on (default " << FrameServerPath() << ")\n";
+	cerr << " -t port  loopback TCP port to listen on instead (" << FrameServerPort << " is usual)\n";
+	cerr << " -r ring  also show frames from a shared memory FrameRing of this name\n";
+	cerr << "Example: " << programName << " /dev/ttyUSB0 /dev/ttyUSB1\n";
+	} // ShowUsage
+
+int main(int argc, char ** argv)
+	{
+	string path(FrameServerPath()), ring;
+	int port = 0;
+	vector<string> devices;
+	for (int arg = 1; arg < argc; ++arg)
+		{
+		string text(argv[arg]);
+		if (("-s" == text) && (arg+1 < argc))
+			path = argv[++arg];
+		else if (("-t" == text) && (arg+1 < argc))
+			{
+			port = atoi(argv[++arg]);
+			path.clear();
+			}
+		else if (("-r" == text) && (arg+1 < argc))
+			ring = argv[++arg];
+		else if ('-' == text[0])
+			{
+			ShowUsage(argv[0]);
+			return -1;
+			}
+		else
+			devices.push_back(text);
+		}
+	if ((true == devices.empty()) || (devices.size() > FrameBatchMax) || ((true == path.empty()) && (port <= 0)))
+		{
+		ShowUsage(argv[0]);
+		return -1;
+		}
+
+	Server server;
+	server.listen_    = -1;
+	server.nextBatch_ = 1;
+	server.received_  = server.frames_ = server.shown_ = server.replaced_ = server.lost_ = 0;
+	if ((false == ring.empty()) && (false == server.ring_.Create(ring,static_cast<int>(devices.size()))))
+		{
+		cerr << "Error making frame ring " << ring << " " << strerror(errno) << endl;
+		return -2;
+		}
+	server.ringSeen_.resize(devices.size());
+	for (size_t pos = 0; pos < devices.size(); ++pos)
+		{ // with no ring, frames only come from clients, so no draw function
+		GadgetDrawFunc draw = server.ring_.IsOpen() ? RingDraw : 0;
+		if (server.manager_.Add(devices[pos],draw,&server) < 0)
+			{
+			cerr << "Error opening port " << devices[pos] << endl;
+			return -2;
+			}
+		}
+	server.outgoing_.resize(devices.size());
+
+	if (false == Listen(server,path,port))
+		{
+		cerr << "Error listening on " << (path.empty() ? "TCP port" : path) << " " << strerror(errno) << endl;
+		return -3;
+		}
+
+	signal(SIGINT,OnSignal);
+	signal(SIGTERM,OnSignal);
+	signal(SIGPIPE,SIG_IGN);
+
+	uint64 report = MonotonicNanos() + ReportNanos;
+	while (0 == stopping)
+		{
+		if (false == server.manager_.Poll(100))
+			break;
+		SendPending(server);
+		if (MonotonicNanos() >= report)
+			{
+			Report(server);
+			report += ReportNanos;
+			}
+		}
+	Report(server);
+
+	while (false == server.clients_.empty())
+		DropClient(server,server.clients_.begin()->first);
+	close(server.listen_);
+	if (false == server.path_.empty())
+		unlink(server.path_.c_str());
+	for (int device = 0; device < server.manager_.Count(); ++device)
+		server.manager_.Remove(device); // logs out
+	return 0;
+	} // main
+
+// end - HypnoD.cpp
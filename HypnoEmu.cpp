@@ -0,0 +1,223 @@
+// hypnoemu - software HypnoCubes on pseudo terminals, to load and time
+// the host code without gadgets
+// Linux, g++ -std=c++11
+
+// Each emulated gadget gets a pseudo terminal; its slave path is printed
+// and can be opened as a serial port by hypnod, HypnoDemo or anything
+// using SerialIO. The line speed, time to carry out a command, size of
+// the gadget's input buffer and what happens when it fills are set on the
+// command line, so driver changes can be timed the same way every run.
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "GadgetEmulator.h" // the gadgets
+#include "Timer.h"          // the clock they run on
+
+using namespace std;
+using namespace HypnoGadget;
+
+namespace {
+
+struct Emulated
+	{
+	Emulated(const EmulatorConfig & config) : gadget_(config), master_(-1), slave_(-1)
+		{
+		}
+	GadgetEmulator gadget_;
+	int master_, slave_;  // the slave is held open so the master never hangs up
+	string path_;
+	vector<uint8> out_;   // replies the master did not take yet
+	};
+
+volatile sig_atomic_t stopping = 0;
+
+const uint64 ReportNanos = 10000000000ULL; // print counts this often
+
+	}; // anonymous namespace
+
+void OnSignal(int)
+	{
+	stopping = 1;
+	} // OnSignal
+
+// a raw pseudo terminal, return false on failure
+bool OpenPty(Emulated & emu)
+	{
+	emu.master_ = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (emu.master_ < 0)
+		return false;
+	if ((0 != grantpt(emu.master_)) || (0 != unlockpt(emu.master_)) || (0 == ptsname(emu.master_)))
+		return false;
+	emu.path_ = ptsname(emu.master_);
+	emu.slave_ = open(emu.path_.c_str(),O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (emu.slave_ < 0)
+		return false;
+	struct termios config;
+	if (0 != tcgetattr(emu.slave_,&config))
+		return false;
+	cfmakeraw(&config);
+	return 0 == tcsetattr(emu.slave_,TCSANOW,&config);
+	} // OpenPty
+
+// write what is waiting, keep what the master will not take
+void Flush(Emulated & emu)
+	{
+	if (true == emu.out_.empty())
+		return;
+	ssize_t written = write(emu.master_,&emu.out_[0],emu.out_.size());
+	if (written > 0)
+		emu.out_.erase(emu.out_.begin(),emu.out_.begin()+written);
+	} // Flush
+
+void Report(vector<Emulated*> & emus)
+	{
+	for (size_t pos = 0; pos < emus.size(); ++pos)
+		{
+		EmulatorStats stats;
+		emus[pos]->gadget_.GetStats(stats);
+		cerr << emus[pos]->path_ << ": " << stats.commands_ << " commands, "
+			<< stats.frames_ << " frames, " << stats.flips_ << " flips, "
+			<< stats.bytesIn_ << " bytes in, " << stats.bytesOut_ << " out, "
+			<< stats.overflowed_ << " overflowed, " << stats.errors_ << " errors, input peak "
+			<< stats.inputPeak_ << (emus[pos]->gadget_.LoggedIn() ? ", logged in" : "") << "\n";
+		}
+	} // Report
+
+// show the usage for the command line parameters
+void ShowUsage(const string & programName)
+	{
+	cerr << "Usage: " << programName << " [-n count] [-b baud] [-c us] [-f us] [-i bytes] [-t ms] [-o drop|block]\n";
+	cerr << " Software gadgets on pseudo terminals, the slave paths are printed one a line.\n";
+	cerr << " -n count   gadgets to emulate, default 1\n";
+	cerr << " -b baud    line speed, 0 for no limit, default 38400\n";
+	cerr << " -c us      microseconds to carry out a command, default 200\n";
+	cerr << " -f us      extra microseconds for a SetFrame, default 800\n";
+	cerr << " -i bytes   the gadget's input buffer, default 256\n";
+	cerr << " -t ms      gap in a command before it is dropped, 0 for none, default " << PacketTimeoutDefault << "\n";
+	cerr << " -o mode    drop bytes when it is full, or block the line, default drop\n";
+	cerr << "Example: " << programName << " -n 4 -b 115200 -o block\n";
+	} // ShowUsage
+
+int main(int argc, char ** argv)
+	{
+	EmulatorConfig config;
+	int count = 1;
+	for (int arg = 1; arg < argc; ++arg)
+		{
+		string text(argv[arg]);
+		if (arg+1 >= argc)
+			{
+			ShowUsage(argv[0]);
+			return -1;
+			}
+		string value(argv[++arg]);
+		if ("-n" == text)
+			count = atoi(value.c_str());
+		else if ("-b" == text)
+			config.baud_ = atoi(value.c_str());
+		else if ("-c" == text)
+			config.commandNanos_ = strtoull(value.c_str(),0,10)*1000;
+		else if ("-f" == text)
+			config.frameNanos_ = strtoull(value.c_str(),0,10)*1000;
+		else if ("-i" == text)
+			config.inputBuffer_ = atoi(value.c_str());
+		else if ("-t" == text)
+			config.packetTimeout_ = atoi(value.c_str());
+		else if (("-o" == text) && ("drop" == value))
+			config.overflow_ = OverflowDrop;
+		else if (("-o" == text) && ("block" == value))
+			config.overflow_ = OverflowBlock;
+		else
+			{
+			ShowUsage(argv[0]);
+			return -1;
+			}
+		}
+	if ((count < 1) || (0 == config.inputBuffer_))
+		{
+		ShowUsage(argv[0]);
+		return -1;
+		}
+
+	vector<Emulated*> emus;
+	for (int pos = 0; pos < count; ++pos)
+		{
+		emus.push_back(new Emulated(config));
+		if (false == OpenPty(*emus.back()))
+			{
+			cerr << "Error making a pseudo terminal " << strerror(errno) << endl;
+			return -2;
+			}
+		cout << emus.back()->path_ << endl;
+		}
+
+	signal(SIGINT,OnSignal);
+	signal(SIGTERM,OnSignal);
+
+	vector<struct pollfd> fds(emus.size());
+	uint64 report = MonotonicNanos() + ReportNanos;
+	while (0 == stopping)
+		{
+		// sleep to the first gadget event, or until a host writes
+		uint64 now = MonotonicNanos(), next = report;
+		for (size_t pos = 0; pos < emus.size(); ++pos)
+			{
+			uint64 event = emus[pos]->gadget_.NextEvent();
+			if (event < next)
+				next = event;
+			fds[pos].fd     = emus[pos]->master_;
+			fds[pos].events = 0;
+			if (0 != emus[pos]->gadget_.Room())
+				fds[pos].events |= POLLIN; // else the pty holds the bytes, as flow control
+			if (false == emus[pos]->out_.empty())
+				fds[pos].events |= POLLOUT;
+			}
+		uint64 wait = (next <= now) ? 0 : next - now; // byte times are well under a millisecond
+		struct timespec timeout = {static_cast<time_t>(wait/1000000000), static_cast<long>(wait%1000000000)};
+		if ((ppoll(&fds[0],fds.size(),&timeout,0) < 0) && (EINTR != errno))
+			break;
+
+		now = MonotonicNanos();
+		for (size_t pos = 0; pos < emus.size(); ++pos)
+			{
+			Emulated & emu = *emus[pos];
+			if (0 != (fds[pos].revents & POLLIN))
+				{
+				uint8 buffer[4096];
+				size_t room = emu.gadget_.Room();
+				ssize_t got = read(emu.master_,buffer,(room < sizeof(buffer)) ? room : sizeof(buffer));
+				if (got > 0)
+					emu.gadget_.Receive(buffer,static_cast<uint16>(got),now);
+				}
+			emu.gadget_.Run(now,emu.out_);
+			Flush(emu);
+			}
+
+		if (now >= report)
+			{
+			Report(emus);
+			report += ReportNanos;
+			}
+		}
+	Report(emus);
+
+	for (size_t pos = 0; pos < emus.size(); ++pos)
+		{
+		close(emus[pos]->slave_);
+		close(emus[pos]->master_);
+		delete emus[pos];
+		}
+	return 0;
+	} // main
+
+// end - HypnoEmu.cpp
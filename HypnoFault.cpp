@@ -0,0 +1,253 @@
+// hypnofault - damages a stream of encoded commands and measures how the
+// packet decoder recovers
+// Linux, g++ -std=c++11
+
+// Commands like a host sends, mostly SetFrame with some FlipFrame and
+// Ping, are encoded as on the wire and passed through a FaultInjector
+// with bit flips, dropped bytes and duplicated SYNCs, then fed to
+// PacketDecodeBytes in serial port sized reads. Decoded commands are
+// matched against those sent. For each kind of fault it prints the
+// commands and bytes lost per fault, and how far past the fault the next
+// good command ended, in bytes and in time at the line speed.
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+
+#include "Packet.h"
+#include "Command.h"
+#include "FaultInjector.h" // the damage
+
+using namespace std;
+using namespace HypnoGadget;
+
+namespace {
+
+// one command as sent
+struct Sent
+	{
+	uint64 start_, end_;     // offsets in the clean stream
+	vector<uint8> data_;     // command byte and payload
+	bool delivered_;
+	};
+
+// what one run found
+struct FaultResult
+	{
+	uint64 faults_, errors_;
+	uint64 lost_, lostBytes_;  // commands not delivered, and their wire bytes
+	uint64 wrong_;             // decoded but matching nothing sent
+	uint64 recoverySum_, recoveryMax_; // bytes from a fault to the end of the next good command
+	};
+
+const char * const FaultNames[FaultTypeCount] = {"bit flip","dropped byte","duplicate SYNC"};
+
+	}; // anonymous namespace
+
+void WriteByte(void * param, uint8 byte)
+	{
+	static_cast<vector<uint8>*>(param)->push_back(byte);
+	} // WriteByte
+
+// count commands like a host sends, encoded one after another into wire
+void MakeCommands(uint32 count, vector<Sent> & sent, vector<uint8> & wire)
+	{
+	PacketHandlerState state;
+	PacketReset(&state);
+	uint32 seed = 12345;
+	sent.resize(count);
+	for (uint32 pos = 0; pos < count; ++pos)
+		{
+		seed = seed*1664525 + 1013904223;
+		Sent & command = sent[pos];
+		uint32 kind = (seed >> 16) % 10;
+		if (kind < 7)
+			{ // SetFrame of a changing image, a few bytes of which need escapes
+			command.data_.resize(97);
+			command.data_[0] = CommandSetFrame;
+			for (int index = 1; index < 97; ++index)
+				{
+				seed = seed*1664525 + 1013904223;
+				command.data_[index] = static_cast<uint8>(seed >> 24);
+				}
+			}
+		else
+			command.data_.assign(1,static_cast<uint8>(kind < 9 ? CommandFlipFrame : CommandPing));
+		command.start_ = wire.size();
+		PacketSendData(&state,WriteByte,&wire,0,&command.data_[0],static_cast<uint16>(command.data_.size()));
+		command.end_ = wire.size();
+		command.delivered_ = false;
+		}
+	} // MakeCommands
+
+// damage the wire with injector, decode it, and match what comes out
+void Run(const vector<uint8> & wire, vector<Sent> & sent, FaultInjector & injector, uint32 baud, FaultResult & result)
+	{
+	memset(&result,0,sizeof(result));
+	for (size_t pos = 0; pos < sent.size(); ++pos)
+		sent[pos].delivered_ = false;
+
+	vector<uint8> damaged;
+	for (size_t pos = 0; pos < wire.size(); pos += 64)
+		{
+		uint16 length = static_cast<uint16>((wire.size() - pos < 64) ? wire.size() - pos : 64);
+		injector.Pass(&wire[pos],length,damaged);
+		}
+
+	PacketHandlerState state;
+	PacketReset(&state);
+	size_t next = 0; // first sent command not yet matched
+	for (size_t pos = 0; pos < damaged.size(); )
+		{ // reads of up to 64 bytes, as GadgetControl::Update does
+		uint16 count = static_cast<uint16>((damaged.size() - pos < 64) ? damaged.size() - pos : 64);
+		const uint8 * bytes = &damaged[pos];
+		pos += count;
+		uint32 now = static_cast<uint32>(pos*10000ULL/baud); // ms the bytes took on the line
+		while (0 != count)
+			{
+			uint16 left = PacketDecodeBytes(&state,bytes,count,now);
+			bytes += count - left;
+			count = left;
+			uint8 dest;
+			uint8 * data;
+			uint16 length;
+			if (true == PacketGetData(&state,&dest,&data,&length))
+				{ // the first match ahead; commands skipped over were lost
+				size_t match = next;
+				while ((match < sent.size()) && (match < next + 64) &&
+					((sent[match].data_.size() != length) || (0 != memcmp(&sent[match].data_[0],data,length))))
+					++match;
+				if ((match < sent.size()) && (match < next + 64))
+					{
+					sent[match].delivered_ = true;
+					next = match + 1;
+					}
+				else
+					++result.wrong_;
+				}
+			if (PacketErrorNone != PacketGetError(&state))
+				{
+				++result.errors_;
+				PacketClearError(&state);
+				}
+			}
+		}
+
+	for (size_t pos = 0; pos < sent.size(); ++pos)
+		if (false == sent[pos].delivered_)
+			{
+			++result.lost_;
+			result.lostBytes_ += sent[pos].end_ - sent[pos].start_;
+			}
+
+	// from each fault to the end of the first command delivered that ends after it
+	const vector<Fault> & faults = injector.Faults();
+	result.faults_ = faults.size();
+	size_t command = 0;
+	for (size_t pos = 0; pos < faults.size(); ++pos)
+		{
+		while ((command < sent.size()) && (sent[command].end_ <= faults[pos].at_))
+			++command;
+		size_t good = command;
+		while ((good < sent.size()) && (false == sent[good].delivered_))
+			++good;
+		uint64 recovery = (good < sent.size() ? sent[good].end_ : wire.size()) - faults[pos].at_;
+		result.recoverySum_ += recovery;
+		if (recovery > result.recoveryMax_)
+			result.recoveryMax_ = recovery;
+		}
+	} // Run
+
+void Print(const string & name, const FaultResult & result, uint32 baud)
+	{
+	double faults = (0 == result.faults_) ? 1.0 : static_cast<double>(result.faults_);
+	double byteMicros = 10.0e6/baud;
+	cout << setw(16) << name << setw(8) << result.faults_ << setw(8) << result.errors_
+		<< setw(7) << result.lost_ << setw(6) << result.wrong_
+		<< fixed << setprecision(2)
+		<< setw(12) << result.lost_/faults << setw(12) << result.lostBytes_/faults
+		<< setw(12) << result.recoverySum_/faults << setw(10) << result.recoveryMax_
+		<< setprecision(0)
+		<< setw(13) << result.recoverySum_/faults*byteMicros << setw(10) << result.recoveryMax_*byteMicros << "\n";
+	} // Print
+
+// show the usage for the command line parameters
+void ShowUsage(const string & programName)
+	{
+	cerr << "Usage: " << programName << " [-n commands] [-f ppm] [-d ppm] [-s ppm] [-r seed] [-b baud]\n";
+	cerr << " Damages encoded commands and measures how the decoder recovers.\n";
+	cerr << " -n commands  commands to send, default 100000\n";
+	cerr << " -f ppm       bit flips per million bytes, default 100\n";
+	cerr << " -d ppm       dropped bytes per million bytes, default 100\n";
+	cerr << " -s ppm       duplicated SYNCs per million SYNCs, default 1000\n";
+	cerr << " -r seed      for the faults, default 1\n";
+	cerr << " -b baud      line speed to give recovery times at, default 38400\n";
+	cerr << "Each kind of fault is run alone, then all together.\n";
+	} // ShowUsage
+
+int main(int argc, char ** argv)
+	{
+	uint32 count = 100000, seed = 1, baud = 38400;
+	uint32 rates[FaultTypeCount] = {100, 100, 1000};
+	for (int arg = 1; arg < argc; ++arg)
+		{
+		string text(argv[arg]);
+		if (arg+1 >= argc)
+			{
+			ShowUsage(argv[0]);
+			return -1;
+			}
+		uint32 value = static_cast<uint32>(strtoul(argv[++arg],0,10));
+		if ("-n" == text)
+			count = value;
+		else if ("-f" == text)
+			rates[FaultBitFlip] = value;
+		else if ("-d" == text)
+			rates[FaultDropByte] = value;
+		else if ("-s" == text)
+			rates[FaultDuplicateSync] = value;
+		else if ("-r" == text)
+			seed = value;
+		else if ("-b" == text)
+			baud = value;
+		else
+			{
+			ShowUsage(argv[0]);
+			return -1;
+			}
+		}
+	if ((0 == count) || (0 == baud))
+		{
+		ShowUsage(argv[0]);
+		return -1;
+		}
+
+	vector<Sent> sent;
+	vector<uint8> wire;
+	MakeCommands(count,sent,wire);
+	cout << count << " commands, " << wire.size() << " bytes on the wire\n";
+	cout << "                                                lost    lost bytes   recovery bytes      recovery us\n";
+	cout << "           fault  faults  errors   lost wrong   per fault   per fault        mean       max         mean       max\n";
+
+	FaultResult result;
+	for (int type = 0; type < FaultTypeCount; ++type)
+		{
+		if (0 == rates[type])
+			continue;
+		FaultInjector injector(seed);
+		injector.SetRate(static_cast<FaultType>(type),rates[type]);
+		Run(wire,sent,injector,baud,result);
+		Print(FaultNames[type],result,baud);
+		}
+	FaultInjector injector(seed);
+	for (int type = 0; type < FaultTypeCount; ++type)
+		injector.SetRate(static_cast<FaultType>(type),rates[type]);
+	Run(wire,sent,injector,baud,result);
+	Print("all",result,baud);
+	return 0;
+	} // main
+
+// end - HypnoFault.cpp
@@ -0,0 +1,331 @@
+// hypnoload - load generator for hypnod
+// Linux, g++ -std=c++11
+
+// Sends batches of frames to hypnod as fast as it answers, or at a set
+// rate, keeping a window of batches in flight. Reports frames per second
+// sent and shown, those dropped for newer ones, and the time from sending
+// a batch to its reply, which hypnod sends once its gadgets ACKed every
+// frame of it or it dropped them.
+// With -m it is instead a producer for hypnod's shared memory FrameRing,
+// writing a frame for every gadget in place each round, and reports the
+// frames hypnod read from the ring and those it found torn.
+
+#include <iostream>
+#include <string>
+#include <deque>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "FrameProtocol.h" // what the daemon takes
+#include "FrameRing.h"     // or where it finds frames
+#include "Latency.h"       // reply time histogram
+#include "Timer.h"         // clocks and batch deadlines
+
+using namespace std;
+using namespace HypnoGadget;
+
+// connect to a Unix socket at path, or loopback TCP port if path is empty
+int Connect(const string & path, int port)
+	{
+	int fd;
+	if (true == path.empty())
+		{
+		fd = socket(AF_INET,SOCK_STREAM | SOCK_CLOEXEC,0);
+		if (fd < 0)
+			return -1;
+		struct sockaddr_in address;
+		memset(&address,0,sizeof(address));
+		address.sin_family      = AF_INET;
+		address.sin_port        = htons(static_cast<uint16>(port));
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		if (0 != connect(fd,reinterpret_cast<struct sockaddr*>(&address),sizeof(address)))
+			{
+			close(fd);
+			return -1;
+			}
+		int one = 1;
+		setsockopt(fd,IPPROTO_TCP,TCP_NODELAY,&one,sizeof(one));
+		}
+	else
+		{
+		fd = socket(AF_UNIX,SOCK_STREAM | SOCK_CLOEXEC,0);
+		if (fd < 0)
+			return -1;
+		struct sockaddr_un address;
+		memset(&address,0,sizeof(address));
+		address.sun_family = AF_UNIX;
+		strncpy(address.sun_path,path.c_str(),sizeof(address.sun_path)-1);
+		if (0 != connect(fd,reinterpret_cast<struct sockaddr*>(&address),sizeof(address)))
+			{
+			close(fd);
+			return -1;
+			}
+		}
+	return fd;
+	} // Connect
+
+// read exactly length bytes, return false on error or close
+bool ReadAll(int fd, uint8 * buffer, size_t length)
+	{
+	while (0 != length)
+		{
+		ssize_t count = recv(fd,buffer,length,0);
+		if ((count < 0) && (EINTR == errno))
+			continue;
+		if (count <= 0)
+			return false;
+		buffer += count;
+		length -= count;
+		}
+	return true;
+	} // ReadAll
+
+bool WriteAll(int fd, const uint8 * buffer, size_t length)
+	{
+	while (0 != length)
+		{
+		ssize_t count = send(fd,buffer,length,MSG_NOSIGNAL);
+		if ((count < 0) && (EINTR == errno))
+			continue;
+		if (count <= 0)
+			return false;
+		buffer += count;
+		length -= count;
+		}
+	return true;
+	} // WriteAll
+
+// a batch of count frames, one device after another, each image different
+void MakeBatch(uint32 sequence, int count, int devices, vector<uint8> & batch)
+	{
+	FrameHeader header = {FrameBatch, static_cast<uint8>(count),
+		static_cast<uint16>(count*FrameEntrySize), sequence};
+	batch.resize(FrameHeaderSize + count*FrameEntrySize);
+	FrameHeaderWrite(header,&batch[0]);
+	for (int entry = 0; entry < count; ++entry)
+		{
+		uint8 * bytes = &batch[FrameHeaderSize + entry*FrameEntrySize];
+		bytes[0] = static_cast<uint8>((sequence*count + entry) % devices);
+		memset(bytes+1,static_cast<uint8>(sequence),WireFrameSize);
+		}
+	} // MakeBatch
+
+// write frames into the ring hypnod made, rate rounds a second or 0 for
+// as fast as possible, each frame filled with its round number in place
+int RingLoad(const string & name, int rate, int seconds)
+	{
+	FrameRing ring;
+	if (false == ring.Open(name))
+		{
+		cerr << "Error opening frame ring " << name << ": " << strerror(errno) << endl;
+		return -2;
+		}
+	int devices = ring.Devices();
+	cout << "frame ring has " << devices << " gadgets\n";
+	uint64 readBefore = 0, tornBefore = 0;
+	for (int device = 0; device < devices; ++device)
+		{
+		uint64 read, torn;
+		ring.Counts(device,read,torn);
+		readBefore += read;
+		tornBefore += torn;
+		}
+
+	FrameScheduler scheduler;
+	if (0 != rate)
+		scheduler.Start(rate);
+	uint64 frames = 0;
+	uint32 round = 0;
+	uint64 start = MonotonicNanos(), end = start + seconds*1000000000ULL;
+	while (MonotonicNanos() < end)
+		{
+		if (0 != rate)
+			scheduler.Wait();
+		for (int device = 0; device < devices; ++device)
+			{
+			uint8 * frame = ring.BeginWrite(device);
+			memset(frame,static_cast<uint8>(round),WireFrameSize);
+			ring.EndWrite(device);
+			}
+		++round;
+		frames += devices;
+		}
+	double elapsed = (MonotonicNanos() - start)/1e9;
+	usleep(100000); // let hypnod take the last frames
+
+	uint64 read = 0, torn = 0;
+	for (int device = 0; device < devices; ++device)
+		{
+		uint64 deviceRead, deviceTorn;
+		ring.Counts(device,deviceRead,deviceTorn);
+		read += deviceRead;
+		torn += deviceTorn;
+		}
+	read -= readBefore;
+	torn -= tornBefore;
+	cout << frames << " frames written in " << elapsed << " s, "
+		<< static_cast<uint64>(frames/elapsed) << " frames/s\n";
+	cout << read << " read by hypnod, " << torn << " torn, "
+		<< ((frames > read + torn) ? frames - read - torn : 0) << " overwritten unread\n";
+	return 0;
+	} // RingLoad
+
+// show the usage for the command line parameters
+void ShowUsage(const string & programName)
+	{
+	cerr << "Usage: " << programName << " [-s path | -t port | -m ring] [-b batch] [-w window] [-r rate] [-d seconds]\n";
+	cerr << " -s path     hypnod Unix domain socket (default " << FrameServerPath() << ")\n";
+	cerr << " -t port     hypnod loopback TCP port instead\n";
+	cerr << " -m ring     write frames into hypnod's shared memory FrameRing instead,\n";
+	cerr << "             rate then being rounds of a frame per gadget\n";
+	cerr << " -b batch    frames per batch, 1-" << FrameBatchMax << " (default 16)\n";
+	cerr << " -w window   batches in flight (default 4)\n";
+	cerr << " -r rate     batches per second, 0 for as fast as answered (default 0)\n";
+	cerr << " -d seconds  how long to run (default 10)\n";
+	} // ShowUsage
+
+int main(int argc, char ** argv)
+	{
+	string path(FrameServerPath()), ring;
+	int port = 0, batchSize = 16, window = 4, rate = 0, seconds = 10;
+	for (int arg = 1; arg < argc; ++arg)
+		{
+		string text(argv[arg]);
+		if (arg+1 >= argc)
+			{
+			ShowUsage(argv[0]);
+			return -1;
+			}
+		if ("-s" == text)
+			path = argv[++arg];
+		else if ("-t" == text)
+			{
+			port = atoi(argv[++arg]);
+			path.clear();
+			}
+		else if ("-m" == text)
+			ring = argv[++arg];
+		else if ("-b" == text)
+			batchSize = atoi(argv[++arg]);
+		else if ("-w" == text)
+			window = atoi(argv[++arg]);
+		else if ("-r" == text)
+			rate = atoi(argv[++arg]);
+		else if ("-d" == text)
+			seconds = atoi(argv[++arg]);
+		else
+			{
+			ShowUsage(argv[0]);
+			return -1;
+			}
+		}
+	if ((batchSize < 1) || (FrameBatchMax < batchSize) || (window < 1) || (rate < 0) || (seconds < 1))
+		{
+		ShowUsage(argv[0]);
+		return -1;
+		}
+	if (false == ring.empty())
+		return RingLoad(ring,rate,seconds);
+
+	int fd = Connect(path,port);
+	if (fd < 0)
+		{
+		cerr << "Error connecting to hypnod: " << strerror(errno) << endl;
+		return -2;
+		}
+	uint8 bytes[FrameHeaderSize];
+	FrameHeader header;
+	if ((false == ReadAll(fd,bytes,FrameHeaderSize)) ||
+		(false == FrameHeaderRead(bytes,header)) || (FrameHello != header.type_))
+		{
+		cerr << "Error: no hello from hypnod\n";
+		close(fd);
+		return -3;
+		}
+	int devices = (0 == header.count_) ? 1 : header.count_;
+	cout << "hypnod has " << static_cast<int>(header.count_) << " gadgets\n";
+
+	FrameScheduler scheduler;
+	if (0 != rate)
+		scheduler.Start(rate);
+
+	deque<uint64> sentAt; // send time of each batch in flight, oldest first
+	uint32 sequence = 0, nextReply = 0;
+	uint64 frames = 0, shown = 0, replaced = 0;
+	LatencyHistogram reply;
+	vector<uint8> batch;
+	bool failed = false;
+	uint64 start = MonotonicNanos(), end = start + seconds*1000000000ULL;
+	while ((false == failed) && ((MonotonicNanos() < end) || (false == sentAt.empty())))
+		{
+		// send while the window is open, and at the rate if one is set
+		while ((sentAt.size() < static_cast<size_t>(window)) && (MonotonicNanos() < end))
+			{
+			if ((0 != rate) && (false == scheduler.Wait(0)))
+				break;
+			MakeBatch(sequence,batchSize,devices,batch);
+			sentAt.push_back(MonotonicNanos());
+			if (false == WriteAll(fd,&batch[0],batch.size()))
+				{
+				failed = true;
+				break;
+				}
+			++sequence;
+			frames += batchSize;
+			}
+		if (true == sentAt.empty())
+			{
+			if (0 != rate)
+				SleepUntilNanos(scheduler.Deadline()); // nothing in flight, sleep to the next batch
+			continue;
+			}
+
+		// wait for a reply, but not past the next batch due
+		int timeoutMs = 100;
+		if ((0 != rate) && (sentAt.size() < static_cast<size_t>(window)))
+			{
+			uint64 now = MonotonicNanos(), due = scheduler.Deadline();
+			timeoutMs = (due > now) ? static_cast<int>((due - now)/1000000) : 0;
+			}
+		struct pollfd ready = {fd, POLLIN, 0};
+		if (poll(&ready,1,timeoutMs) <= 0)
+			continue;
+		uint8 body[FrameReplySize];
+		if ((false == ReadAll(fd,bytes,FrameHeaderSize)) ||
+			(false == FrameHeaderRead(bytes,header)) || (FrameReply != header.type_) ||
+			(nextReply != header.sequence_) || (false == ReadAll(fd,body,FrameReplySize)))
+			{
+			cerr << "Error: bad reply from hypnod\n";
+			failed = true;
+			break;
+			}
+		reply.Record(MonotonicNanos() - sentAt.front());
+		sentAt.pop_front();
+		++nextReply;
+		shown    += header.count_;
+		replaced += body[0];
+		}
+	close(fd);
+
+	double elapsed = (MonotonicNanos() - start)/1e9;
+	cout << frames << " frames sent, " << shown << " shown, " << replaced
+		<< " replaced by newer ones, " << frames - shown - replaced << " lost in " << elapsed << " s\n";
+	cout << static_cast<uint64>(frames/elapsed) << " frames/s sent, "
+		<< static_cast<uint64>(shown/elapsed) << " frames/s shown\n";
+	cout << "batch reply us: p50 " << reply.Percentile(50)/1000
+		<< " p90 " << reply.Percentile(90)/1000
+		<< " p99 " << reply.Percentile(99)/1000
+		<< " max " << reply.Max()/1000 << "\n";
+	return (true == failed) ? -4 : 0;
+	} // main
+
+// end - HypnoLoad.cpp
@@ -0,0 +1,176 @@
+// hypnoreplay - plays a capture from GadgetControl::StartRecording back
+// through the gadget code, at the original pace or as fast as possible
+
+// Bytes the gadget sent go in through GadgetIO and Update, so they are
+// decoded and processed as they were live; bytes the host wrote go to
+// ReplayWritten so their ACKs are matched. Use it to reproduce what a
+// gadget in the field did, or to time the decoder on real traffic.
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <cstdlib>
+
+#include "Gadget.h"       // the code being replayed
+#include "WireRecorder.h" // capture files
+#include "Timer.h"        // pacing and timing
+
+using namespace std;
+using namespace HypnoGadget;
+
+// GadgetIO handing out captured bytes, and dropping what is written
+class ReplayIO : public GadgetIO
+	{
+public:
+	ReplayIO(void) : written_(0)
+		{
+		}
+	void Push(const vector<uint8> & bytes)
+		{
+		in_.insert(in_.end(),bytes.begin(),bytes.end());
+		}
+	bool Pending(void) const
+		{
+		return false == in_.empty();
+		}
+	uint16 ReadBytes(uint8 * buffer, uint16 length)
+		{
+		uint16 count = 0;
+		while ((count < length) && (false == in_.empty()))
+			{
+			buffer[count++] = in_.front();
+			in_.pop_front();
+			}
+		return count;
+		}
+	void WriteBytes(const uint8 *, uint16 length)
+		{
+		written_ += length;
+		}
+	uint64 Written(void) const
+		{
+		return written_;
+		}
+private:
+	deque<uint8> in_;
+	uint64 written_;
+	}; // class ReplayIO
+
+// one thread, so no locking
+class ReplayLock : public GadgetLock
+	{
+public:
+	void Lock(void)
+		{
+		}
+	void Unlock(void)
+		{
+		}
+	}; // class ReplayLock
+
+// show the usage for the command line parameters
+void ShowUsage(const string & programName)
+	{
+	cerr << "Usage: " << programName << " capture [-f] [-v] [-n count]\n";
+	cerr << " Plays a capture back through the gadget code.\n";
+	cerr << " -f        as fast as possible, else at the pace it was recorded\n";
+	cerr << " -v        print the message log, errors and error counts\n";
+	cerr << " -n count  play it count times, to time the decoder\n";
+	cerr << "Example: " << programName << " field.cap -f -n 100\n";
+	} // ShowUsage
+
+int main(int argc, char ** argv)
+	{
+	if (argc < 2)
+		{
+		ShowUsage(argv[0]);
+		return -1;
+		}
+	string path(argv[1]);
+	bool fast = false, verbose = false;
+	int count = 1;
+	for (int arg = 2; arg < argc; ++arg)
+		{
+		string text(argv[arg]);
+		if ("-f" == text)
+			fast = true;
+		else if ("-v" == text)
+			verbose = true;
+		else if (("-n" == text) && (arg+1 < argc))
+			count = atoi(argv[++arg]);
+		else
+			{
+			ShowUsage(argv[0]);
+			return -1;
+			}
+		}
+	if (count < 1)
+		{
+		ShowUsage(argv[0]);
+		return -1;
+		}
+
+	ReplayIO ioObj;
+	ReplayLock lockObj;
+	GadgetControl gadget(ioObj,lockObj);
+
+	uint64 recordsIn = 0, recordsOut = 0, bytesIn = 0, bytesOut = 0;
+	uint64 decodeNanos = 0; // in Update, decoding and processing what was read
+	for (int pass = 0; pass < count; ++pass)
+		{
+		WireCapture capture;
+		if (false == capture.Open(path))
+			{
+			cerr << "Error: " << path << " is not a capture\n";
+			return -2;
+			}
+		uint64 start = MonotonicNanos();
+		WireRecord record;
+		while (true == capture.Next(record))
+			{
+			if (false == fast)
+				SleepUntilNanos(start + record.nanos_);
+			if (WireOut == record.direction_)
+				{
+				++recordsOut;
+				bytesOut += record.bytes_.size();
+				gadget.ReplayWritten(&record.bytes_[0],static_cast<uint16>(record.bytes_.size()));
+				continue;
+				}
+			++recordsIn;
+			bytesIn += record.bytes_.size();
+			ioObj.Push(record.bytes_);
+			uint64 before = MonotonicNanos();
+			while (true == ioObj.Pending())
+				gadget.Update();
+			decodeNanos += MonotonicNanos() - before;
+			}
+		}
+
+	cout << recordsIn << " reads of " << bytesIn << " bytes, "
+		<< recordsOut << " writes of " << bytesOut << " bytes\n";
+	if (0 != decodeNanos)
+		cout << "decoded " << bytesIn*1000/decodeNanos << " MB/s, "
+			<< decodeNanos/(0 == recordsIn ? 1 : recordsIn) << " ns per read\n";
+	cout << "state at the end: " << (GadgetControl::LoggedIn == gadget.GetState() ? "logged in" : "logged out") << "\n";
+
+	if (true == verbose)
+		{
+		string message;
+		for (int index = 0; true == gadget.GetMessage(message,index); ++index)
+			cout << message << "\n";
+		string error;
+		if (true == gadget.Error(error))
+			cout << "last error: " << error << "\n";
+		string errors;
+		gadget.GetErrorReport(errors);
+		cout << errors;
+		string latency;
+		gadget.GetLatencyReport(latency);
+		cout << latency;
+		}
+	return 0;
+	} // main
+
+// end - HypnoReplay.cpp
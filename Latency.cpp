@@ -0,0 +1,129 @@
+// HypnoCOMM - serial communications for the HypnoGadgets
+// www.HypnoCube.com, www.HypnoSquare.com
+// latency histograms of frames on their way to the gadget
+#include "Latency.h"
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+
+namespace HypnoGadget {
+
+LatencyHistogram::LatencyHistogram(void)
+	{
+	Clear();
+	} // LatencyHistogram
+
+void LatencyHistogram::Clear(void)
+	{
+	memset(buckets_,0,sizeof(buckets_));
+	count_ = sum_ = max_ = 0;
+	min_ = ~0ULL;
+	} // Clear
+
+// bucket holding a value
+int LatencyHistogram::Bucket(uint64 nanos)
+	{
+	if (nanos < SubCount)
+		return static_cast<int>(nanos);
+	// find the top bit, then keep SubBits bits below it
+	int top = SubBits;
+	while ((top < 63) && (nanos >> (top+1)))
+		++top;
+	int shift = top - SubBits;
+	return SubCount*(shift+1) + static_cast<int>((nanos >> shift) & (SubCount-1));
+	} // Bucket
+
+// largest value in a bucket
+uint64 LatencyHistogram::BucketHigh(int bucket)
+	{
+	if (bucket < SubCount)
+		return bucket;
+	int shift = bucket/SubCount - 1;
+	uint64 low = static_cast<uint64>(SubCount + bucket%SubCount) << shift;
+	return low + (1ULL << shift) - 1;
+	} // BucketHigh
+
+void LatencyHistogram::Record(uint64 nanos)
+	{
+	++buckets_[Bucket(nanos)];
+	++count_;
+	sum_ += nanos;
+	if (nanos < min_)
+		min_ = nanos;
+	if (nanos > max_)
+		max_ = nanos;
+	} // Record
+
+void LatencyHistogram::Merge(const LatencyHistogram & other)
+	{
+	for (int bucket = 0; bucket < BucketCount; ++bucket)
+		buckets_[bucket] += other.buckets_[bucket];
+	count_ += other.count_;
+	sum_   += other.sum_;
+	if (other.min_ < min_)
+		min_ = other.min_;
+	if (other.max_ > max_)
+		max_ = other.max_;
+	} // Merge
+
+// value at or below which the given percent of values fall
+uint64 LatencyHistogram::Percentile(double percent) const
+	{
+	if (0 == count_)
+		return 0;
+	uint64 wanted = static_cast<uint64>(percent*count_/100.0 + 0.5);
+	if (wanted < 1)
+		wanted = 1;
+	uint64 seen = 0;
+	for (int bucket = 0; bucket < BucketCount; ++bucket)
+		{
+		seen += buckets_[bucket];
+		if (seen >= wanted)
+			{ // bucket top, but never past the real extremes
+			uint64 value = BucketHigh(bucket);
+			if (value > max_)
+				value = max_;
+			if (value < min_)
+				value = min_;
+			return value;
+			}
+		}
+	return max_;
+	} // Percentile
+
+const char * LatencyStageName(LatencyStage stage)
+	{
+	static const char * names[LatencyStageCount] = {
+		"encode", "queue", "ack", "total"
+		};
+	if ((stage < 0) || (LatencyStageCount <= stage))
+		return "unknown";
+	return names[stage];
+	} // LatencyStageName
+
+// one line per stage, in microseconds
+void LatencyReport(const LatencyHistogram * stages, string & text)
+	{
+	char line[200];
+	text = "stage        count      min     mean      p50      p90      p99    p99.9      max (us)\n";
+	for (int stage = 0; stage < LatencyStageCount; ++stage)
+		{
+		const LatencyHistogram & h = stages[stage];
+		sprintf(line,"%-8s %9lu %8lu %8lu %8lu %8lu %8lu %8lu %8lu\n",
+			LatencyStageName(static_cast<LatencyStage>(stage)),
+			static_cast<unsigned long>(h.Count()),
+			static_cast<unsigned long>(h.Min()/1000),
+			static_cast<unsigned long>(h.Mean()/1000),
+			static_cast<unsigned long>(h.Percentile(50)/1000),
+			static_cast<unsigned long>(h.Percentile(90)/1000),
+			static_cast<unsigned long>(h.Percentile(99)/1000),
+			static_cast<unsigned long>(h.Percentile(99.9)/1000),
+			static_cast<unsigned long>(h.Max()/1000));
+		text += line;
+		}
+	} // LatencyReport
+
+}; // namespace HypnoGadget
+
+// end - Latency.cpp
@@ -0,0 +1,69 @@
+// HypnoCOMM - serial communications for the HypnoGadgets
+// www.HypnoCube.com, www.HypnoSquare.com
+// header for latency histograms of frames on their way to the gadget
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include "defines.h"
+#include <string>
+
+namespace HypnoGadget {
+
+/* Histogram of nanosecond latencies with fixed relative precision. Values
+   below 16 get a bucket each, above that every power of two is split into
+   16 buckets, so any value is known to within about 6 percent from 1ns to
+   hundreds of years in a fixed 4K table, and recording is a few shifts.
+*/
+class LatencyHistogram
+	{
+public:
+	enum {
+		SubBits     = 4,
+		SubCount    = 1<<SubBits,            // buckets per power of two
+		BucketCount = SubCount*(65-SubBits)  // enough for any uint64
+		};
+
+	LatencyHistogram(void);
+
+	void Clear(void);
+	void Record(uint64 nanos);
+	void Merge(const LatencyHistogram & other);
+
+	uint64 Count(void) const { return count_; }
+	uint64 Min(void) const { return 0 == count_ ? 0 : min_; }
+	uint64 Max(void) const { return max_; }
+	uint64 Mean(void) const { return 0 == count_ ? 0 : sum_/count_; }
+
+	// value at or below which the given percent 0-100 of values fall,
+	// accurate to the bucket size
+	uint64 Percentile(double percent) const;
+
+	// bucket holding a value, and the largest value in a bucket
+	static int Bucket(uint64 nanos);
+	static uint64 BucketHigh(int bucket);
+
+private:
+	uint32 buckets_[BucketCount];
+	uint64 count_, sum_, min_, max_;
+	}; // class LatencyHistogram
+
+// stages of a frame from starting to draw it to the gadget ACKing it
+enum LatencyStage
+	{
+	LatencyEncode,  // start of drawing to SetFrame command encoded
+	LatencyQueue,   // encoded to handed to GadgetIO::WriteBytes
+	LatencyAck,     // written to ACK received
+	LatencyTotal,   // start of drawing to ACK received
+	LatencyStageCount
+	};
+
+// name of a stage, for reports
+const char * LatencyStageName(LatencyStage stage);
+
+// one line per stage of count, min, mean, percentiles and max, in microseconds
+void LatencyReport(const LatencyHistogram * stages, std::string & text);
+
+}; // namespace HypnoGadget
+
+#endif // LATENCY_H
+// end - Latency.h
@@ -0,0 +1,269 @@
+// HypnoCOMM - serial communications for the HypnoGadgets
+// www.HypnoCube.com, www.HypnoSquare.com
+// a file of gadget metadata, to skip enumeration on reconnect
+#include "MetaCache.h"
+#include <cstdio>
+#include <cstring>
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace HypnoGadget {
+
+namespace {
+
+const uint8 Magic[4] = {'H','Y','P','M'};
+
+// read only view of a whole file
+class MappedFile
+	{
+public:
+	MappedFile(const string & path) : data_(0), size_(0)
+		{
+#ifdef WIN32
+		mapping_ = 0;
+		file_ = CreateFileA(path.c_str(),GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,0,NULL);
+		if (INVALID_HANDLE_VALUE == file_)
+			return;
+		size_ = GetFileSize(file_,NULL);
+		if ((0 == size_) || (INVALID_FILE_SIZE == size_))
+			{
+			size_ = 0;
+			return;
+			}
+		mapping_ = CreateFileMappingA(file_,NULL,PAGE_READONLY,0,0,NULL);
+		if (0 != mapping_)
+			data_ = reinterpret_cast<const uint8*>(MapViewOfFile(mapping_,FILE_MAP_READ,0,0,0));
+		if (0 == data_)
+			size_ = 0;
+#else
+		file_ = open(path.c_str(),O_RDONLY);
+		if (file_ < 0)
+			return;
+		struct stat info;
+		if ((0 != fstat(file_,&info)) || (0 == info.st_size))
+			return;
+		void * view = mmap(0,info.st_size,PROT_READ,MAP_PRIVATE,file_,0);
+		if (MAP_FAILED == view)
+			return;
+		data_ = reinterpret_cast<const uint8*>(view);
+		size_ = static_cast<uint32>(info.st_size);
+#endif
+		}
+	~MappedFile(void)
+		{
+#ifdef WIN32
+		if (0 != data_)
+			UnmapViewOfFile(data_);
+		if (0 != mapping_)
+			CloseHandle(mapping_);
+		if (INVALID_HANDLE_VALUE != file_)
+			CloseHandle(file_);
+#else
+		if (0 != data_)
+			munmap(const_cast<uint8*>(data_),size_);
+		if (file_ >= 0)
+			close(file_);
+#endif
+		}
+
+	const uint8 * data_;
+	uint32 size_;
+private:
+#ifdef WIN32
+	HANDLE file_, mapping_;
+#else
+	int file_;
+#endif
+	}; // class MappedFile
+
+// little endian reader that fails, rather than reading past the end
+class Reader
+	{
+public:
+	Reader(const uint8 * data, uint32 size) : data_(data), left_(size), ok_(true) {}
+
+	bool Bytes(uint8 * dest, uint32 length)
+		{
+		if ((false == ok_) || (length > left_))
+			return ok_ = false;
+		memcpy(dest,data_,length);
+		data_ += length;
+		left_ -= length;
+		return true;
+		}
+	uint32 U16(void)
+		{
+		uint8 b[2] = {0,0};
+		Bytes(b,2);
+		return b[0] | (b[1]<<8);
+		}
+	uint32 U32(void)
+		{
+		uint8 b[4] = {0,0,0,0};
+		Bytes(b,4);
+		return b[0] | (b[1]<<8) | (b[2]<<16) | (static_cast<uint32>(b[3])<<24);
+		}
+	void String(string & text)
+		{
+		uint32 length = U16();
+		if ((false == ok_) || (length > left_))
+			{
+			ok_ = false;
+			return;
+			}
+		text.assign(reinterpret_cast<const char*>(data_),length);
+		data_ += length;
+		left_ -= length;
+		}
+	void Strings(vector<string> & list)
+		{
+		uint32 count = U16();
+		list.clear();
+		for (uint32 pos = 0; (pos < count) && (true == ok_); ++pos)
+			{
+			list.push_back(string());
+			String(list.back());
+			}
+		}
+
+	const uint8 * data_;
+	uint32 left_;
+	bool ok_;
+	}; // class Reader
+
+// little endian writer into a byte vector
+void PutU16(vector<uint8> & out, uint32 value)
+	{
+	out.push_back(static_cast<uint8>(value));
+	out.push_back(static_cast<uint8>(value>>8));
+	}
+void PutU32(vector<uint8> & out, uint32 value)
+	{
+	PutU16(out,value & 0xFFFF);
+	PutU16(out,value >> 16);
+	}
+void PutString(vector<uint8> & out, const string & text)
+	{
+	PutU16(out,static_cast<uint32>(text.size()));
+	out.insert(out.end(),text.begin(),text.end());
+	}
+void PutStrings(vector<uint8> & out, const vector<string> & list)
+	{
+	PutU16(out,static_cast<uint32>(list.size()));
+	for (size_t pos = 0; pos < list.size(); ++pos)
+		PutString(out,list[pos]);
+	}
+
+bool SameKey(const DeviceMeta & meta, const string & identity, const string & name,
+	const uint8 * versions)
+	{
+	return (meta.identity_ == identity) && (meta.name_ == name) &&
+		(0 == memcmp(meta.versions_,versions,sizeof(meta.versions_)));
+	}
+
+	}; // anonymous namespace
+
+// read a cache file
+bool MetaCache::Load(const string & path)
+	{
+	entries_.clear();
+	MappedFile file(path);
+	if (0 == file.data_)
+		return false;
+
+	Reader in(file.data_,file.size_);
+	uint8 magic[4];
+	in.Bytes(magic,4);
+	if ((false == in.ok_) || (0 != memcmp(magic,Magic,4)) || (FormatVersion != in.U32()))
+		return false;
+
+	uint32 count = in.U32();
+	for (uint32 pos = 0; (pos < count) && (true == in.ok_); ++pos)
+		{
+		DeviceMeta meta;
+		in.String(meta.identity_);
+		in.Bytes(meta.versions_,sizeof(meta.versions_));
+		in.String(meta.name_);
+		in.String(meta.description_);
+		in.String(meta.copyright_);
+		in.Strings(meta.visualizations_);
+		in.Strings(meta.transitions_);
+		if (true == in.ok_)
+			entries_.push_back(meta);
+		}
+	if (false == in.ok_)
+		entries_.clear(); // truncated or damaged, trust none of it
+	return in.ok_;
+	} // Load
+
+// write the cache file, to a temporary then renamed over the old one,
+// so a crash never leaves half a file
+bool MetaCache::Save(const string & path) const
+	{
+	vector<uint8> out(Magic,Magic+4);
+	PutU32(out,FormatVersion);
+	PutU32(out,static_cast<uint32>(entries_.size()));
+	for (size_t pos = 0; pos < entries_.size(); ++pos)
+		{
+		const DeviceMeta & meta = entries_[pos];
+		PutString(out,meta.identity_);
+		out.insert(out.end(),meta.versions_,meta.versions_+sizeof(meta.versions_));
+		PutString(out,meta.name_);
+		PutString(out,meta.description_);
+		PutString(out,meta.copyright_);
+		PutStrings(out,meta.visualizations_);
+		PutStrings(out,meta.transitions_);
+		}
+
+	string temp = path + ".tmp";
+	FILE * file = fopen(temp.c_str(),"wb");
+	if (0 == file)
+		return false;
+	bool ok = (out.size() == fwrite(&out[0],1,out.size(),file));
+	ok = (0 == fclose(file)) && ok;
+#ifdef WIN32
+	ok = ok && (0 != MoveFileExA(temp.c_str(),path.c_str(),MOVEFILE_REPLACE_EXISTING));
+#else
+	ok = ok && (0 == rename(temp.c_str(),path.c_str()));
+#endif
+	if (false == ok)
+		remove(temp.c_str());
+	return ok;
+	} // Save
+
+// entry for a gadget, 0 if none
+const DeviceMeta * MetaCache::Find(const string & identity, const string & name,
+	const uint8 * versions) const
+	{
+	for (size_t pos = 0; pos < entries_.size(); ++pos)
+		if (true == SameKey(entries_[pos],identity,name,versions))
+			return &entries_[pos];
+	return 0;
+	} // Find
+
+// add an entry, replacing one with the same key
+void MetaCache::Store(const DeviceMeta & meta)
+	{
+	for (size_t pos = 0; pos < entries_.size(); ++pos)
+		if (true == SameKey(entries_[pos],meta.identity_,meta.name_,meta.versions_))
+			{
+			entries_.erase(entries_.begin()+pos);
+			break;
+			}
+	entries_.push_back(meta);
+	if (entries_.size() > MaxEntries)
+		entries_.erase(entries_.begin());
+	} // Store
+
+}; // namespace HypnoGadget
+
+// end - MetaCache.cpp
@@ -0,0 +1,60 @@
+// HypnoCOMM - serial communications for the HypnoGadgets
+// www.HypnoCube.com, www.HypnoSquare.com
+// header for a file of gadget metadata, to skip enumeration on reconnect
+#ifndef METACACHE_H
+#define METACACHE_H
+
+#include "defines.h"
+#include <string>
+#include <vector>
+
+namespace HypnoGadget {
+
+// what Enumerate reads from a gadget that only new firmware changes. The
+// options are left out, as they change on the gadget and are always read
+struct DeviceMeta
+	{
+	std::string identity_;   // chosen by the caller, such as the port name
+	uint8 versions_[6];      // hardware, software, protocol major and minor
+	std::string name_, description_, copyright_;
+	std::vector<std::string> visualizations_, transitions_;
+	};
+
+/* Metadata of gadgets seen before, kept in a small binary file. An entry
+   is keyed by identity, device name and the versions from CommandVersion, so
+   new firmware or a different gadget on the port misses and is read again.
+   The file is memory mapped to load and replaced whole to save. It starts
+   with a format version; a file of another version is ignored.
+*/
+class MetaCache
+	{
+public:
+	enum {
+		FormatVersion = 2,  // 1 also held the options
+		MaxEntries    = 64  // oldest dropped past this
+		};
+
+	// read a cache file, return false and leave the cache empty if
+	// missing or not readable
+	bool Load(const std::string & path);
+
+	// write the cache file, return true on success
+	bool Save(const std::string & path) const;
+
+	// entry for a gadget, 0 if none
+	const DeviceMeta * Find(const std::string & identity, const std::string & name,
+		const uint8 * versions) const;
+
+	// add an entry, replacing one with the same key
+	void Store(const DeviceMeta & meta);
+
+	uint32 Count(void) const { return static_cast<uint32>(entries_.size()); }
+
+private:
+	std::vector<DeviceMeta> entries_; // oldest first
+	}; // class MetaCache
+
+}; // namespace HypnoGadget
+
+#endif // METACACHE_H
+// end - MetaCache.h
@@ -0,0 +1,123 @@
+// HypnoCOMM - serial communications for the HypnoGadgets
+// www.HypnoCube.com, www.HypnoSquare.com
+// converting Options to and from the bytes the gadget stores
+#include "OptionsCodec.h"
+#include <cstring>
+
+namespace HypnoGadget {
+
+namespace {
+
+// field by field little endian writer
+class Encoder
+	{
+public:
+	Encoder(uint8 * data) : data_(data) {}
+	void U8(uint8 value)   { *data_++ = value; }
+	void Bool(bool value)  { U8(value ? 1 : 0); }
+	void U16(uint16 value) { U8(static_cast<uint8>(value)); U8(static_cast<uint8>(value>>8)); }
+	void U32(uint32 value) { U16(static_cast<uint16>(value)); U16(static_cast<uint16>(value>>16)); }
+	uint8 * data_;
+	}; // class Encoder
+
+// field by field little endian reader
+class Decoder
+	{
+public:
+	Decoder(const uint8 * data) : data_(data) {}
+	uint8 U8(void)   { return *data_++; }
+	bool Bool(void)  { return 0 != U8(); }
+	uint16 U16(void) { uint16 low = U8(); return static_cast<uint16>(low | (U8()<<8)); }
+	uint32 U32(void) { uint32 low = U16(); return low | (static_cast<uint32>(U16())<<16); }
+	const uint8 * data_;
+	}; // class Decoder
+
+	}; // anonymous namespace
+
+// write opts as OptionsWireSize bytes, in struct order
+void OptionsEncode(const Options & opts, uint8 * data)
+	{
+	Encoder out(data);
+	out.U8(opts.command_);
+	out.U8(opts.optionsVersion_);
+	out.U16(opts.storeCount_);
+	for (int pos = 0; pos < 16; ++pos)
+		out.U32(opts.randState_[pos]);
+	out.U8(opts.easterCounter_);
+	out.U16(opts.runCount_);
+	out.U16(opts.deviceId_);
+	out.U32(opts.challenge_);
+	out.Bool(opts.requirePing_);
+	out.U8(opts.pingDelay_);
+
+	out.Bool(opts.playSequentialVis_);
+	out.Bool(opts.useGlobalSpeed_);
+	out.U8(opts.minVisSpeed_);
+	out.U8(opts.maxVisSpeed_);
+	for (int pos = 0; pos < VIS_MAX; ++pos)
+		{
+		out.U8(opts.visOptions_[pos].minSpeed_);
+		out.U8(opts.visOptions_[pos].maxSpeed_);
+		out.U8(opts.visOptions_[pos].frequency_);
+		out.U16(opts.visOptions_[pos].count_);
+		}
+	for (int pos = 0; pos < VIS_MAX; ++pos)
+		out.U8(opts.visOrder_[pos]);
+
+	out.Bool(opts.playSequentialTrans_);
+	for (int pos = 0; pos < TRANS_MAX; ++pos)
+		{
+		out.U8(opts.transOptions_[pos].frequency_);
+		out.U16(opts.transOptions_[pos].count_);
+		}
+	for (int pos = 0; pos < TRANS_MAX; ++pos)
+		out.U8(opts.transOrder_[pos]);
+	} // OptionsEncode
+
+// read opts from a block, return false if the length or version is wrong
+bool OptionsDecode(const uint8 * data, uint16 length, Options & opts)
+	{
+	if ((OptionsWireSize != length) || (OPTIONS_VERSION != data[1]))
+		return false;
+
+	Decoder in(data);
+	opts.command_ = in.U8();
+	opts.optionsVersion_ = in.U8();
+	opts.storeCount_ = in.U16();
+	for (int pos = 0; pos < 16; ++pos)
+		opts.randState_[pos] = in.U32();
+	opts.easterCounter_ = in.U8();
+	opts.runCount_ = in.U16();
+	opts.deviceId_ = in.U16();
+	opts.challenge_ = in.U32();
+	opts.requirePing_ = in.Bool();
+	opts.pingDelay_ = in.U8();
+
+	opts.playSequentialVis_ = in.Bool();
+	opts.useGlobalSpeed_ = in.Bool();
+	opts.minVisSpeed_ = in.U8();
+	opts.maxVisSpeed_ = in.U8();
+	for (int pos = 0; pos < VIS_MAX; ++pos)
+		{
+		opts.visOptions_[pos].minSpeed_ = in.U8();
+		opts.visOptions_[pos].maxSpeed_ = in.U8();
+		opts.visOptions_[pos].frequency_ = in.U8();
+		opts.visOptions_[pos].count_ = in.U16();
+		}
+	for (int pos = 0; pos < VIS_MAX; ++pos)
+		opts.visOrder_[pos] = in.U8();
+
+	opts.playSequentialTrans_ = in.Bool();
+	for (int pos = 0; pos < TRANS_MAX; ++pos)
+		{
+		opts.transOptions_[pos].frequency_ = in.U8();
+		opts.transOptions_[pos].count_ = in.U16();
+		}
+	for (int pos = 0; pos < TRANS_MAX; ++pos)
+		opts.transOrder_[pos] = in.U8();
+	return true;
+	} // OptionsDecode
+
+}; // namespace HypnoGadget
+
+// end - OptionsCodec.cpp
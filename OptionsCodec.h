@@ -0,0 +1,30 @@
+// HypnoCOMM - serial communications for the HypnoGadgets
+// www.HypnoCube.com, www.HypnoSquare.com
+// header for converting Options to and from the bytes the gadget stores
+#ifndef OPTIONSCODEC_H
+#define OPTIONSCODEC_H
+
+#include "defines.h"
+#include "options.h"
+
+namespace HypnoGadget {
+
+enum {
+	// bytes in the Options block on the wire, the PIC layout, which
+	// is packed and little endian whatever the host compiler does
+	OptionsWireSize = 1 + 1 + 2 + 16*4 + 1 + 2 + 2 + 4 + 1 + 1 +
+		1 + 1 + 1 + 1 + VIS_MAX*5 + VIS_MAX +
+		1 + TRANS_MAX*3 + TRANS_MAX
+	};
+static_assert(OPTIONS_SIZE == OptionsWireSize, "Options fields do not add up to the PIC block size");
+
+// write opts as OptionsWireSize bytes
+void OptionsEncode(const Options & opts, uint8 * data);
+
+// read opts from a block, return false if the length or version is wrong
+bool OptionsDecode(const uint8 * data, uint16 length, Options & opts);
+
+}; // namespace HypnoGadget
+
+#endif // OPTIONSCODEC_H
+// end - OptionsCodec.h
@@ -44,8 +44,17 @@ void PacketReset(PacketHandlerState * state)
 	state->packetSequence_ = 0; // sequence counter for the packet decoding
 
 	state->syncCounter_ = 0;
+
+	state->lastTime_ = 0;
+	state->timeout_  = PacketTimeoutDefault;
 	} // PacketReset
 
+// longest gap between bytes of a command
+void PacketSetTimeout(PacketHandlerState * state, uint32 timeout)
+	{
+	state->timeout_ = timeout;
+	} // PacketSetTimeout
+
 // call this to set a packet error
 static void SetPacketError(PacketHandlerState * state, PacketError error)
 	{
@@ -53,6 +62,43 @@ static void SetPacketError(PacketHandlerState * state, PacketError error)
 	state->packetError_ = error;
 	} // PacketError
 
+// a packet was bad, so the command it belongs to is lost. Drop what was
+// merged of it, the next command starts with sequence 0
+static void PacketDrop(PacketHandlerState * state, PacketError error)
+	{
+	SetPacketError(state,error);
+	state->decodeLength_   = 0;
+	state->packetSequence_ = 0;
+	} // PacketDrop
+
+// drop a command left partly decoded if no bytes came for longer than
+// the timeout, return true if it was dropped
+static bool PacketStale(PacketHandlerState * state, uint32 now)
+	{
+	if ((0 != state->timeout_) && (now - state->lastTime_ > state->timeout_) &&
+		((0 != state->decodeLength_) || (0 != state->packetPos_)))
+		{ // stale, the rest is not coming
+		PacketDrop(state,PacketErrorTimeout);
+		state->packetPos_ = 0;
+		state->lastTime_  = now;
+		return true;
+		}
+	return false;
+	} // PacketStale
+
+// the caller found no bytes waiting at now
+void PacketIdle(PacketHandlerState * state, uint32 now)
+	{
+	if (false == state->dataBlockReady_)
+		PacketStale(state,now);
+	} // PacketIdle
+
+// bytes were read at now, however long they waited
+void PacketBytesArrived(PacketHandlerState * state, uint32 now)
+	{
+	state->lastTime_ = now;
+	} // PacketBytesArrived
+
 // every time a packet is decoded, this merges it into a larger data store
 // when done, it sets a flag. Routine also removes ESCaped characters from stream, 
 // checks packet integrity, and sets internal error conditions as needed.
@@ -64,7 +110,7 @@ static void PacketDecode(PacketHandlerState * state)
 	// error - no packet this small
 	if (state->packetPos_ < PacketOverhead+1)
 		{
-		SetPacketError(state,PacketErrorLength);
+		PacketDrop(state,PacketErrorLength);
 		return;
 		}
 
@@ -82,7 +128,7 @@ static void PacketDecode(PacketHandlerState * state)
 				byte = PacketESC;
 			else
 				{ // error - unknown ESC sequence
-				SetPacketError(state,PacketErrorDecode);
+				PacketDrop(state,PacketErrorDecode);
 				return;
 				}
 			}
@@ -99,21 +145,26 @@ static void PacketDecode(PacketHandlerState * state)
 	state->packetDecodedCRC_ = crc2; // save last decoded CRC
 	if (crc1 != crc2)
 		{
-		SetPacketError(state,PacketErrorChecksum);
+		PacketDrop(state,PacketErrorChecksum);
 		return;
 		}
 
-	// check sequence
+	// check sequence. A first packet where a later one was due starts a
+	// new command, the rest of the last was lost, but this one is good
 	if (state->packetSequence_ != (state->packetData_[0] & PacketSequenceMask))
 		{
-		SetPacketError(state,PacketErrorSequence);
-		return;
+		if (0 != (state->packetData_[0] & PacketSequenceMask))
+			{
+			PacketDrop(state,PacketErrorSequence);
+			return;
+			}
+		PacketDrop(state,PacketErrorMissing);
 		}
 	
 	// check claimed and real length
 	if (state->packetPos_ != state->packetData_[1] + PacketOverhead)
 		{
-		SetPacketError(state,PacketErrorLength);
+		PacketDrop(state,PacketErrorLength);
 		return;
 		}
 
@@ -128,7 +179,7 @@ static void PacketDecode(PacketHandlerState * state)
 		{
 		if (state->decodeLength_ >= sizeof(state->decodeData_))
 			{ // too big
-			SetPacketError(state,PacketErrorOverflow);
+			PacketDrop(state,PacketErrorOverflow);
 			return;
 			}
 		state->decodeData_[state->decodeLength_++] = state->packetData_[pos];
@@ -142,7 +193,7 @@ static void PacketDecode(PacketHandlerState * state)
 		}
 	else if (PacketNotLast != type)
 		{ // not a legal type
-		SetPacketError(state,PacketErrorType);
+		PacketDrop(state,PacketErrorType);
 		return;
 		}
 
@@ -155,24 +206,31 @@ static void PacketDecode(PacketHandlerState * state)
 // returns number of unprocessed bytes, which are likely the next packet. 
 // After processing the packet data, the data is prepared to be read by 
 // PacketGetData. 
-// If embedded text is found, return textLength which is the number of text 
-// characters AFTER the other bytes were processed, and this count is not 
-// included in the unprocessed byte count.
-uint16 PacketDecodeBytes(PacketHandlerState * state, const uint8 * data, uint16 length)
+// Every SYNC ends whatever came since the last one, so SYNC SYNC between
+// packets is an empty packet and ignored, and after damage the decoder is
+// back in step at the next SYNC with nothing that follows lost. Bytes
+// before the first SYNC are text, skipped with PacketErrorSYNC.
+// A command stalled longer than the timeout is dropped before new bytes
+// are looked at, so a sender that gave up does not spoil its next command.
+uint16 PacketDecodeBytes(PacketHandlerState * state, const uint8 * data, uint16 length, uint32 now)
 	{
 	if (true == state->dataBlockReady_)
 		return length; // done - this needs to be handled before any more work can be done
+	if (true == PacketStale(state,now))
+		return length;
+	if (0 != length)
+		state->lastTime_ = now;
 	while (length)
 		{
 		uint8 byte = *data++;
 		length--;
 		++state->byteCount_; // one more eaten
-		if (0 == (state->syncCounter_&1))
-			{ // first byte better be a SYNC byte, else an error
+		if (0 == state->syncCounter_)
+			{ // hunting for a SYNC
 			if (PacketSYNC != byte)
 				{ // we are in a text stream, count em out and return
 				// walk until buffer done or next byte is sync, throwing out bytes
-				while ((length>0) && (*(data+1) != PacketSYNC))
+				while ((length>0) && (*data != PacketSYNC))
 					{
 					length--;
 					data++;
@@ -181,42 +239,30 @@ uint16 PacketDecodeBytes(PacketHandlerState * state, const uint8 * data, uint16
 				SetPacketError(state,PacketErrorSYNC);
 				return length;
 				}
-			++state->syncCounter_;
-			// check if next byte is sync, in which case we're off by one
-			// so resync to the stream
-			if ((PacketSYNC == *data) && (length>0))
+			state->syncCounter_ = 1; // now in packets until lost again
+			state->packetPos_ = 0;
+			}
+		else if (PacketSYNC == byte)
+			{ // end of a packet, if there was one, and maybe the start of the next
+			if (0 != state->packetPos_)
 				{
-				byte = *data++;
-				length--;
-				++state->byteCount_;
+				uint32 errors = state->errorCount_;
+				PacketDecode(state); // decode and place into proper place
+				state->packetPos_ = 0;
+				if ((true == state->dataBlockReady_) || (errors != state->errorCount_))
+					return length; // done - this needs to be handled before any more work can be done
 				}
-			// now in packet until next SYNC byte
+			}
+		else if (state->packetPos_ >= sizeof(state->packetData_))
+			{ // overflow, drop it and hunt for the next SYNC
+			PacketDrop(state,PacketErrorOverflow);
+			state->syncCounter_ = 0;
+			state->packetPos_ = 0;
+			return length;
 			}
 		else
-			{ // between SYNCs:
-			  // copy characters into buffer until second SYNC, or until full, in which case an error
-			  // unpack ESCaped characters along the way
-			if (PacketSYNC == byte)
-				{ // second SYNC, if no errors, process packet
-				++state->syncCounter_;
-				if (PacketErrorNone == state->packetError_)
-					{
-					PacketDecode(state); // decode and place into proper place
-					if (true == state->dataBlockReady_)
-						return length; // done - this needs to be handled before any more work can be done
-					}
-				else
-					return length; // if in an error state, return
-				}
-			else if (state->packetPos_ >= sizeof(state->packetData_))
-				{ // overflow
-				SetPacketError(state,PacketErrorOverflow);
-				return length;
-				}
-			else
-				{ // regular byte, store it
-				state->packetData_[state->packetPos_++] = byte;
-				}
+			{ // regular byte, store it
+			state->packetData_[state->packetPos_++] = byte;
 			}
 		}
 	return 0;
@@ -248,13 +294,13 @@ bool PacketGetData(PacketHandlerState * state, uint8 * destination, uint8 ** dat
 	return true;
 	} // PacketGetData
 
-// send a block of data of given length
-// to the destination item (0 = broadcast)
-// return true iff sent ok
-bool PacketSendData(PacketHandlerState * state, void (*IOWriteByte)(void * param, uint8), void * ioParam, uint8 destination, const uint8 * data, uint16 length)
+// send head then data as one block, so a command byte and its
+// payload need not be copied together first
+static bool PacketSend(PacketHandlerState * state, void (*IOWriteByte)(void * param, uint8), void * ioParam, uint8 destination, const uint8 * head, uint16 headLength, const uint8 * data, uint16 length)
 	{
 	uint8 buffer[PacketOverhead+PacketPayLength+1]; // space for constructing a single packet
 	uint8 sequence = 0; // number of packets sent this data block
+	length += headLength;
 	while (length > 0)
 		{
 		uint16 pos;       // general counter
@@ -280,7 +326,15 @@ bool PacketSendData(PacketHandlerState * state, void (*IOWriteByte)(void * param
 		buffer[dest++] = destination;            // item id to talk to
 
 		while (curLength--)
-			buffer[dest++] = *data++;            // copy data bytes to packet
+			{ // copy data bytes to packet, head first
+			if (0 != headLength)
+				{
+				buffer[dest++] = *head++;
+				--headLength;
+				}
+			else
+				buffer[dest++] = *data++;
+			}
 
 		// now checksum the packet
 		crc = CRC16(buffer,dest);
@@ -317,8 +371,22 @@ bool PacketSendData(PacketHandlerState * state, void (*IOWriteByte)(void * param
 		} // while packets left to send
 	assert(0 == length);
 	return true;
+	} // PacketSend
+
+// send a block of data of given length
+// to the destination item (0 = broadcast)
+// return true iff sent ok
+bool PacketSendData(PacketHandlerState * state, void (*IOWriteByte)(void * param, uint8), void * ioParam, uint8 destination, const uint8 * data, uint16 length)
+	{
+	return PacketSend(state, IOWriteByte, ioParam, destination, 0, 0, data, length);
 	} // PacketSendData
 
+// send a command byte followed by its data, read in place
+bool PacketSendCommand(PacketHandlerState * state, void (*IOWriteByte)(void * param, uint8), void * ioParam, uint8 destination, uint8 command, const uint8 * data, uint16 length)
+	{
+	return PacketSend(state, IOWriteByte, ioParam, destination, &command, 1, data, length);
+	} // PacketSendCommand
+
 // read this to see if there is any errors before getting or sending packet data
 PacketError PacketGetError(PacketHandlerState * state)
 	{
@@ -357,15 +425,11 @@ uint16 PacketCRC(PacketHandlerState * state, bool decoded)
 	return state->packetEncodedCRC_;
 	}
 
-// clear the internal error state
+// clear the internal error state. The decoder has already dropped what
+// the error spoiled, so it carries on from where it is
 void PacketClearError(PacketHandlerState * state)
 	{
 	state->packetError_ = PacketErrorNone;
-	state->syncCounter_ = 0;
-	state->packetPos_   = 0;
-	state->packetSequence_ = 0; 
-	state->decodeLength_ = 0;
-	state->dataBlockReady_ = false;
 	}
 
 #ifdef WIN32
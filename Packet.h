@@ -30,7 +30,8 @@ enum {
 	PacketTypeShift = 5,     // bits to shift to get type out
 	PacketDataStart = 3,     // offset where data starts in a packet
 	PacketOverhead  = 5,     // bytes overhead on data per packet
-	PacketDestLoc   = 2      // byte with packet destination in header
+	PacketDestLoc   = 2,     // byte with packet destination in header
+	PacketTimeoutDefault = 100 // ticks between bytes before a partial command is dropped
 	};
 
 
@@ -72,7 +73,11 @@ typedef struct {
 	uint8 packetSequence_; // sequence counter for the packet decoding
 
 	// state for byte decoder
-	uint8 syncCounter_;  // keeps track of if we're between SYNC characters
+	uint8 syncCounter_;  // 0 while hunting for a SYNC, after text or an overflow
+
+	// timing out a command left partly decoded, in the caller's ticks
+	uint32 lastTime_;    // when bytes last came in
+	uint32 timeout_;     // longest gap allowed inside a command, 0 for none
 
 	} PacketHandlerState;
 
@@ -83,14 +88,34 @@ void PacketReset(PacketHandlerState * state);
 // read this to see if there is any errors before getting or sending packet data
 PacketError PacketGetError(PacketHandlerState * state);
 
-// clear the internal error state
+// clear the internal error state, after reading it. What the error
+// spoiled is already dropped, good packets after it are kept
 void PacketClearError(PacketHandlerState * state);
 
 // passes data into the packet decoding system
 // returns number of unprocessed bytes, which are likely the next packet. 
 // After processing the packet data, the data is prepared to be read by 
-// PacketGetData. 
-uint16 PacketDecodeBytes(PacketHandlerState * state, const uint8 * data, uint16 length);
+// PacketGetData. It also returns after each error, so it can be read, and
+// picks up again at the next SYNC.
+// now is a clock in ticks, such as milliseconds, that may wrap. If more
+// than the timeout passed since the last bytes with a command partly
+// decoded, the part is dropped with PacketErrorTimeout before the new bytes.
+uint16 PacketDecodeBytes(PacketHandlerState * state, const uint8 * data, uint16 length, uint32 now);
+
+// longest gap in ticks allowed between bytes of a command, 0 for none.
+// PacketReset sets PacketTimeoutDefault
+void PacketSetTimeout(PacketHandlerState * state, uint32 timeout);
+
+// tell the decoder no bytes were waiting at now, so the line was quiet
+// since the last ones, and drop a command stalled past the timeout. For a
+// caller that polls, where time between reads is its own and not the
+// line's: it calls PacketBytesArrived for each read with bytes before
+// decoding them, so gaps are only judged here
+void PacketIdle(PacketHandlerState * state, uint32 now);
+
+// tell the decoder bytes were read at now, without judging the gap since
+// the last ones, as they may have waited on the caller
+void PacketBytesArrived(PacketHandlerState * state, uint32 now);
 
 // send a block of data of given length
 // to the destination item (0 = broadcast)
@@ -98,6 +123,10 @@ uint16 PacketDecodeBytes(PacketHandlerState * state, const uint8 * data, uint16
 // todo- comment
 bool PacketSendData(PacketHandlerState * state, void (*IOWriteByte)(void * param, uint8), void * ioParam, uint8 destination, const uint8 * data, uint16 length);
 
+// send a command byte followed by length bytes of data, the same as
+// PacketSendData of both together, but the data is read where it lies
+bool PacketSendCommand(PacketHandlerState * state, void (*IOWriteByte)(void * param, uint8), void * ioParam, uint8 destination, uint8 command, const uint8 * data, uint16 length);
+
 // see if a packet is ready, returns true iff one is ready
 // sets a pointer to the decoded data
 // if one was ready, resets internals to process the next packet
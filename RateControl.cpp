@@ -0,0 +1,132 @@
+// HypnoCOMM - serial communications for the HypnoGadgets
+// www.HypnoCube.com, www.HypnoSquare.com
+// choosing a frame rate the gadget keeps up with
+#include "RateControl.h"
+#include <cstring>
+
+namespace HypnoGadget {
+
+namespace {
+const uint64 WindowNanos = 1000000000ULL;
+const uint64 SlackNanos  = 2000000; // round trip growth always allowed, for jitter
+	}; // anonymous namespace
+
+RateController::RateController(uint32 minRate, uint32 maxRate, uint32 startRate)
+	{
+	memset(&stats_,0,sizeof(stats_));
+	minRate_ = minRate;
+	maxRate_ = maxRate;
+	rate_    = startRate;
+	ceiling_ = 0;
+	goodWindows_ = 0;
+	windowStart_ = 0;
+	sent_ = acked_ = 0;
+	roundTripSum_ = 0;
+	errorTotal_ = windowErrorTotal_ = 0;
+	SetLimits(minRate,maxRate);
+	} // RateController
+
+void RateController::Clamp(void)
+	{
+	if (rate_ < minRate_)
+		rate_ = minRate_;
+	if (rate_ > maxRate_)
+		rate_ = maxRate_;
+	stats_.rate_ = rate_;
+	} // Clamp
+
+// limits of the rate; equal limits fix the rate
+void RateController::SetLimits(uint32 minRate, uint32 maxRate)
+	{
+	minRate_ = (0 == minRate) ? 1 : minRate;
+	maxRate_ = (maxRate < minRate_) ? minRate_ : maxRate;
+	Clamp();
+	} // SetLimits
+
+void RateController::FrameSent(uint64 now)
+	{
+	if (0 == windowStart_)
+		windowStart_ = now;
+	++sent_;
+	Judge(now);
+	} // FrameSent
+
+void RateController::FrameAcked(uint64 roundTrip, uint64 now)
+	{
+	++acked_;
+	roundTripSum_ += roundTrip;
+	Judge(now);
+	} // FrameAcked
+
+void RateController::Errors(uint32 total, uint64 now)
+	{
+	errorTotal_ = total;
+	Judge(now);
+	} // Errors
+
+// judge the window if a second has passed
+void RateController::Judge(uint64 now)
+	{
+	if ((0 == windowStart_) || (now - windowStart_ < WindowNanos))
+		return;
+
+	// ACKs lag the frames by a round trip, so allow one missing
+	uint32 errors = errorTotal_ - windowErrorTotal_;
+	uint32 lost   = (sent_ > acked_ + 1) ? sent_ - acked_ - 1 : 0;
+	uint64 latency = (0 == acked_) ? 0 : roundTripSum_/acked_;
+
+	bool behind = (0 != errors) || (0 != lost);
+	if (0 != acked_)
+		{
+		if ((0 == stats_.baseline_) || (latency < stats_.baseline_))
+			stats_.baseline_ = latency;
+		else // drift up slowly, in case the link itself got slower
+			stats_.baseline_ += (latency - stats_.baseline_)/64;
+		// half again the best round trip means bytes are queueing somewhere
+		if (latency > stats_.baseline_ + stats_.baseline_/2 + SlackNanos)
+			behind = true;
+		}
+
+	if (true == behind)
+		{ // back off by a quarter, remembering where trouble began
+		ceiling_ = rate_;
+		rate_ -= rate_/4;
+		goodWindows_ = 0;
+		++stats_.decreases_;
+		}
+	else if (0 != acked_)
+		{ // creep up, waiting longer before retrying the rate that failed
+		++goodWindows_;
+		if ((0 == ceiling_) || (rate_ + 1 < ceiling_) || (goodWindows_ >= ProbeWindows))
+			{
+			if (rate_ < maxRate_)
+				{
+				++rate_;
+				++stats_.increases_;
+				}
+			goodWindows_ = 0;
+			}
+		}
+	Clamp();
+
+	stats_.ceiling_ = ceiling_;
+	stats_.latency_ = latency;
+	stats_.errors_  = errors;
+	stats_.lost_    = lost;
+	++stats_.windows_;
+
+	// start the next window
+	windowStart_ = now;
+	sent_ = acked_ = 0;
+	roundTripSum_ = 0;
+	windowErrorTotal_ = errorTotal_;
+	} // Judge
+
+void RateController::GetStats(RateStats & stats) const
+	{
+	stats = stats_;
+	} // GetStats
+
+}; // namespace HypnoGadget
+
+// end - RateControl.cpp
@@ -0,0 +1,77 @@
+// HypnoCOMM - serial communications for the HypnoGadgets
+// www.HypnoCube.com, www.HypnoSquare.com
+// header for choosing a frame rate the gadget keeps up with
+#ifndef RATECONTROL_H
+#define RATECONTROL_H
+
+#include "defines.h"
+
+namespace HypnoGadget {
+
+// what the rate controller has seen and done
+struct RateStats
+	{
+	uint32 rate_;       // frames per second now
+	uint32 ceiling_;    // lowest rate that has run into trouble, 0 if none
+	uint32 windows_;    // one second windows judged
+	uint32 increases_;  // windows that raised the rate
+	uint32 decreases_;  // windows that lowered the rate
+	uint64 baseline_;   // best mean ACK round trip in a window, in ns
+	uint64 latency_;    // mean ACK round trip in the last window, in ns
+	uint32 errors_;     // packet errors in the last window
+	uint32 lost_;       // frames not ACKed in the last window
+	};
+
+/* Finds the fastest frame rate a gadget keeps up with. Each second the
+   ACK round trips, errors and unACKed frames are judged. When the gadget
+   falls behind, shown by round trips growing past the best seen or frames
+   going missing, the rate is cut by a quarter. Otherwise it goes up a frame
+   per second, and more slowly near the rate that last caused trouble, so
+   it settles just below what the cable and firmware can take.
+*/
+class RateController
+	{
+public:
+	enum {
+		DefaultMinRate   = 4,
+		DefaultMaxRate   = 30, // going much faster can lock up the device
+		DefaultStartRate = 12,
+		ProbeWindows     = 10  // good windows before trying the rate that failed
+		};
+
+	RateController(uint32 minRate = DefaultMinRate, uint32 maxRate = DefaultMaxRate,
+		uint32 startRate = DefaultStartRate);
+
+	// limits of the rate; equal limits fix the rate
+	void SetLimits(uint32 minRate, uint32 maxRate);
+
+	// report frames going out and ACKs coming back, at MonotonicNanos now
+	void FrameSent(uint64 now);
+	void FrameAcked(uint64 roundTrip, uint64 now);
+	// running total of packet errors seen
+	void Errors(uint32 total, uint64 now);
+
+	// frames per second to send at
+	uint32 Rate(void) const { return rate_; }
+
+	void GetStats(RateStats & stats) const;
+
+private:
+	void Judge(uint64 now); // judge the window if a second has passed
+	void Clamp(void);
+
+	uint32 minRate_, maxRate_, rate_, ceiling_;
+	uint32 goodWindows_; // in a row
+
+	uint64 windowStart_;
+	uint32 sent_, acked_;
+	uint64 roundTripSum_;
+	uint32 errorTotal_, windowErrorTotal_;
+
+	RateStats stats_;
+	}; // class RateController
+
+}; // namespace HypnoGadget
+
+#endif // RATECONTROL_H
+// end - RateControl.h
@@ -0,0 +1,225 @@
+// HypnoCOMM - serial communications for the HypnoGadgets
+// www.HypnoCube.com, www.HypnoSquare.com
+// rendering frames for many gadgets on a pool of threads
+#include "RenderPool.h"
+
+using namespace std;
+
+namespace HypnoGadget {
+
+FrameMailbox::FrameMailbox(void) : middle_(1), back_(0), front_(2)
+	{
+	for (int index = 0; index < 3; ++index)
+		ticks_[index] = 0;
+	} // FrameMailbox
+
+// hand Back to the reader, and take the middle buffer to fill next
+void FrameMailbox::Publish(uint64 tick)
+	{
+	ticks_[back_] = tick;
+	back_ = middle_.exchange(back_ | FreshFlag, memory_order_acq_rel) & 3;
+	} // Publish
+
+// take the newest frame, giving the reader's old buffer back to the middle
+const uint8 * FrameMailbox::Take(uint64 & tick)
+	{
+	if (0 == (middle_.load(memory_order_relaxed) & FreshFlag))
+		return 0;
+	front_ = middle_.exchange(front_, memory_order_acq_rel) & 3;
+	tick = ticks_[front_];
+	return frames_[front_];
+	} // Take
+
+RenderPool::RenderPool(RenderFunc render, void * param, int devices, int threads)
+	: render_(render), param_(param), sleepers_(0), queued_(0), stopping_(false), busy_(0), taken_(0)
+	{
+	if (threads <= 0)
+		threads = static_cast<int>(thread::hardware_concurrency());
+	if (threads <= 0)
+		threads = 1;
+	for (int device = 0; device < devices; ++device)
+		{
+		Slot * slot = new Slot;
+		slot->busy_     = false;
+		slot->nextTick_ = 0;
+		slots_.push_back(slot);
+		}
+	sem_init(&wake_,0,0);
+	// devices map to threads in turn, and each has one task at most
+	uint64 size = 1;
+	while (size*threads < static_cast<uint64>(devices))
+		size <<= 1;
+	for (int index = 0; index < threads; ++index)
+		{
+		Worker * worker = new Worker;
+		worker->ring_ = new atomic<int>[size];
+		worker->mask_ = size - 1;
+		worker->top_  = worker->bottom_ = 0;
+		worker->rendered_ = worker->stolen_ = 0;
+		workers_.push_back(worker);
+		}
+	// start only once every deque exists, since threads steal from all
+	for (int index = 0; index < threads; ++index)
+		workers_[index]->thread_ = thread(&RenderPool::Run,this,index);
+	} // RenderPool
+
+RenderPool::~RenderPool(void)
+	{
+	stopping_ = true;
+	for (size_t index = 0; index < workers_.size(); ++index)
+		sem_post(&wake_);
+	for (size_t index = 0; index < workers_.size(); ++index)
+		workers_[index]->thread_.join();
+	for (size_t index = 0; index < workers_.size(); ++index)
+		{
+		delete [] workers_[index]->ring_;
+		delete workers_[index];
+		}
+	for (size_t index = 0; index < slots_.size(); ++index)
+		delete slots_[index];
+	sem_destroy(&wake_);
+	} // ~RenderPool
+
+// ask for device's frame at tick, unless its last one is still going
+bool RenderPool::Submit(int device, uint64 tick)
+	{
+	if ((device < 0) || (Devices() <= device))
+		return false;
+	Slot * slot = slots_[device];
+	if (true == slot->busy_.exchange(true,memory_order_acquire))
+		{
+		++busy_;
+		return false;
+		}
+	slot->tick_ = tick; // published by the push
+	Push(workers_[device % workers_.size()],device);
+	// count the task, then look for sleepers; Run does the reverse, so
+	// either it sees the task or we see it and post
+	++queued_;
+	if (0 != sleepers_.load())
+		sem_post(&wake_);
+	return true;
+	} // Submit
+
+// newest finished frame for device since the last Take
+const uint8 * RenderPool::Take(int device, uint64 & tick)
+	{
+	if ((device < 0) || (Devices() <= device))
+		return 0;
+	const uint8 * frame = slots_[device]->mailbox_.Take(tick);
+	if (0 != frame)
+		++taken_;
+	return frame;
+	} // Take
+
+// send the newest frame, if any, and submit the next
+void RenderPool::Draw(int device, GadgetControl & gadget)
+	{
+	if ((device < 0) || (Devices() <= device))
+		return;
+	uint64 tick;
+	const uint8 * frame = Take(device,tick);
+	if (0 != frame)
+		{
+		gadget.SetFrame(frame);
+		gadget.FlipFrame();
+		}
+	Slot * slot = slots_[device];
+	if (true == Submit(device,slot->nextTick_))
+		++slot->nextTick_;
+	} // Draw
+
+void RenderPool::DrawFunc(void * pool, int device, GadgetControl & gadget)
+	{
+	static_cast<RenderPool*>(pool)->Draw(device,gadget);
+	} // DrawFunc
+
+// add a device's task to the bottom of a deque, from the one submitting
+// thread. Never full, as each device has one task at most
+void RenderPool::Push(Worker * worker, int device)
+	{
+	uint64 bottom = worker->bottom_.load(memory_order_relaxed);
+	worker->ring_[bottom & worker->mask_].store(device,memory_order_relaxed);
+	worker->bottom_.store(bottom+1,memory_order_release);
+	} // Push
+
+// take the task at the top of a deque. False if it is empty or another
+// thread took it first
+bool RenderPool::Steal(Worker * worker, int & device)
+	{
+	uint64 top    = worker->top_.load(memory_order_acquire);
+	uint64 bottom = worker->bottom_.load(memory_order_acquire);
+	if (top >= bottom)
+		return false;
+	// may be overwritten once another takes it, when the swap fails
+	device = worker->ring_[top & worker->mask_].load(memory_order_relaxed);
+	return worker->top_.compare_exchange_strong(top,top+1,memory_order_acq_rel,memory_order_relaxed);
+	} // Steal
+
+// oldest task from our own deque, else from another's
+bool RenderPool::Pop(int index, int & device)
+	{
+	Worker * own = workers_[index];
+	if (true == Steal(own,device))
+		return true;
+	int count = Threads();
+	for (int step = 1; step < count; ++step)
+		{
+		if (true == Steal(workers_[(index + step) % count],device))
+			{
+			++own->stolen_;
+			return true;
+			}
+		}
+	return false;
+	} // Pop
+
+// render tasks until the pool is destroyed
+void RenderPool::Run(int index)
+	{
+	Worker * worker = workers_[index];
+	while (false == stopping_.load())
+		{
+		int device;
+		if (true == Pop(index,device))
+			{
+			--queued_;
+			Slot * slot = slots_[device];
+			render_(param_,device,slot->tick_,slot->mailbox_.Back());
+			slot->mailbox_.Publish(slot->tick_);
+			++worker->rendered_;
+			slot->busy_.store(false,memory_order_release);
+			continue;
+			}
+		if (0 != queued_.load())
+			{ // another thread won the task, or is about to count it taken
+			this_thread::yield();
+			continue;
+			}
+		// nothing anywhere, sleep until Submit posts. We count ourselves
+		// before looking for tasks, and Submit counts its task before
+		// looking for sleepers, so one of us sees the other. A post for a
+		// thread that did not sleep after all only costs a later pass
+		++sleepers_;
+		if ((0 == queued_.load()) && (false == stopping_.load()))
+			sem_wait(&wake_);
+		--sleepers_;
+		}
+	} // Run
+
+void RenderPool::GetStats(RenderStats & stats) const
+	{
+	stats.threads_  = Threads();
+	stats.rendered_ = stats.stolen_ = 0;
+	for (size_t index = 0; index < workers_.size(); ++index)
+		{
+		stats.rendered_ += workers_[index]->rendered_.load();
+		stats.stolen_   += workers_[index]->stolen_.load();
+		}
+	stats.busy_  = busy_.load();
+	stats.taken_ = taken_.load();
+	} // GetStats
+
+}; // namespace HypnoGadget
+
+// end - RenderPool.cpp
@@ -0,0 +1,148 @@
+// HypnoCOMM - serial communications for the HypnoGadgets
+// www.HypnoCube.com, www.HypnoSquare.com
+// header for rendering frames for many gadgets on a pool of threads
+#ifndef RENDERPOOL_H
+#define RENDERPOOL_H
+
+#include "Gadget.h"
+#include "WireCache.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <semaphore.h>
+
+namespace HypnoGadget {
+
+/* Triple buffer handing finished frames from a render thread to the I/O
+   thread. The writer fills Back and Publishes it; the reader Takes the
+   newest published frame. Neither ever waits: the three buffers are
+   swapped with one atomic exchange each, and a frame not taken before the
+   next is published is dropped. One writer at a time, one reader.
+*/
+class FrameMailbox
+	{
+public:
+	FrameMailbox(void);
+
+	// writer side: fill Back, then Publish it as the frame for tick
+	uint8 * Back(void) { return frames_[back_]; }
+	void Publish(uint64 tick);
+
+	// reader side: newest frame published since the last Take, else 0.
+	// Valid until the next Take
+	const uint8 * Take(uint64 & tick);
+
+private:
+	enum {FreshFlag = 4}; // set in middle_ when it holds an untaken frame
+	uint8 frames_[3][WireFrameSize];
+	uint64 ticks_[3];
+	std::atomic<int> middle_; // buffer between the two sides, plus FreshFlag
+	int back_;                // writer's buffer
+	int front_;               // reader's buffer
+
+	FrameMailbox(const FrameMailbox &);             // not copyable
+	FrameMailbox & operator=(const FrameMailbox &);
+	}; // class FrameMailbox
+
+// renders the frame for device at tick into 96 bytes. Called on pool
+// threads, never for the same device on two threads at once
+typedef void (*RenderFunc)(void * param, int device, uint64 tick, uint8 * frame);
+
+// pool counts
+struct RenderStats
+	{
+	uint32 threads_;
+	uint64 rendered_; // frames rendered
+	uint64 stolen_;   // of those, taken from another thread's queue
+	uint64 busy_;     // Submits refused while the device's last frame rendered
+	uint64 taken_;    // frames handed to the I/O side
+	};
+
+/* Renders frames for many gadgets across all cores. Each (device, tick) is
+   one task, queued on the deque of the thread the device maps to; a thread
+   takes the oldest task from its own deque, and with none left steals from
+   another's. Finished frames go to the device's FrameMailbox, so the I/O
+   thread picks them up without waiting on a render.
+
+   Nothing locks. The deques are Chase-Lev work-stealing deques whose
+   bottom end only the submitting thread pushes, so every render thread
+   takes from the top with one compare and swap as a Chase-Lev thief does.
+   A device has at most one task queued or rendering, so a deque never
+   holds more than its devices and is a fixed ring. Idle threads sleep on
+   a semaphore, which Submit posts only when one may be asleep and which
+   never blocks it. Submit and Draw are called from one thread at a time.
+
+   DrawFunc fits GadgetManager: with the pool as its param, each frame
+   deadline sends the newest finished frame and asks for the next, so
+   drawing runs one tick ahead of the port.
+*/
+class RenderPool
+	{
+public:
+	// devices is the number of device slots, threads 0 for one per core
+	RenderPool(RenderFunc render, void * param, int devices, int threads = 0);
+	~RenderPool(void);
+
+	// ask for device's frame at tick. Return false if its last frame is
+	// still rendering, or device is out of range
+	bool Submit(int device, uint64 tick);
+
+	// newest finished frame for device since the last Take, else 0
+	const uint8 * Take(int device, uint64 & tick);
+
+	// draw on a gadget: send the newest frame, if any, and submit the next
+	void Draw(int device, GadgetControl & gadget);
+	static void DrawFunc(void * pool, int device, GadgetControl & gadget);
+
+	int Threads(void) const { return static_cast<int>(workers_.size()); }
+	int Devices(void) const { return static_cast<int>(slots_.size()); }
+	void GetStats(RenderStats & stats) const;
+
+private:
+	// one per thread: its deque of device numbers, Submit pushes the
+	// bottom, every thread takes the top
+	struct Worker
+		{
+		std::atomic<int> * ring_;    // mask_ + 1 entries
+		uint64 mask_;
+		std::atomic<uint64> top_;    // next to take
+		std::atomic<uint64> bottom_; // next to push
+		std::thread thread_;
+		std::atomic<uint64> rendered_, stolen_;
+		};
+	std::vector<Worker*> workers_;
+
+	// one per device
+	struct Slot
+		{
+		FrameMailbox mailbox_;
+		std::atomic<bool> busy_; // a task is queued or rendering
+		uint64 tick_;            // of that task, set before it is pushed
+		uint64 nextTick_;        // for Draw
+		};
+	std::vector<Slot*> slots_;
+
+	RenderFunc render_;
+	void * param_;
+
+	// idle threads sleep here until work is submitted
+	sem_t wake_;
+	std::atomic<int> sleepers_;
+	std::atomic<int> queued_;  // tasks in all deques
+	std::atomic<bool> stopping_;
+
+	std::atomic<uint64> busy_, taken_;
+
+	void Run(int index);                    // thread body
+	bool Pop(int index, int & device);      // own deque, else steal
+	static void Push(Worker * worker, int device);
+	static bool Steal(Worker * worker, int & device);
+
+	RenderPool(const RenderPool &);             // not copyable
+	RenderPool & operator=(const RenderPool &);
+	}; // class RenderPool
+
+}; // namespace HypnoGadget
+
+#endif // RENDERPOOL_H
+// end - RenderPool.h
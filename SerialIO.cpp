@@ -0,0 +1,159 @@
+// HypnoCOMM - serial communications for the HypnoGadgets
+// www.HypnoCube.com, www.HypnoSquare.com
+// a POSIX serial port GadgetIO, for event loops
+#include "SerialIO.h"
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include <errno.h>
+
+using namespace std;
+
+namespace HypnoGadget {
+
+namespace {
+
+// errors that only mean try again later
+bool Transient(int error)
+	{
+	return (EAGAIN == error) || (EWOULDBLOCK == error) || (EINTR == error);
+	} // Transient
+
+	}; // anonymous namespace
+
+SerialIO::SerialIO(void) : fd_(-1), readFull_(false), failed_(false), bytesRead_(0), bytesWritten_(0), writeStalls_(0)
+	{
+	} // SerialIO
+
+SerialIO::~SerialIO(void)
+	{
+	Close();
+	} // ~SerialIO
+
+// open a port at 38400 8N1, raw, the settings of the gadgets
+bool SerialIO::Open(const string & portName)
+	{
+	Close();
+	int fd = open(portName.c_str(),O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (fd < 0)
+		return false;
+
+	struct termios config;
+	if (0 != tcgetattr(fd,&config))
+		{
+		close(fd);
+		return false;
+		}
+	cfmakeraw(&config);
+	cfsetispeed(&config,B38400);
+	cfsetospeed(&config,B38400);
+	config.c_cflag |= CLOCAL | CREAD;
+	config.c_cflag &= ~(CSTOPB | PARENB | CRTSCTS);
+	config.c_cc[VMIN]  = 0;
+	config.c_cc[VTIME] = 0;
+	if (0 != tcsetattr(fd,TCSANOW,&config))
+		{
+		close(fd);
+		return false;
+		}
+	tcflush(fd,TCIOFLUSH);
+
+	fd_ = fd;
+	name_ = portName;
+	return true;
+	} // Open
+
+// use a descriptor that is not a serial port, such as a pseudo terminal
+bool SerialIO::Attach(int fd, const string & name)
+	{
+	Close();
+	if (fd < 0)
+		return false;
+	int flags = fcntl(fd,F_GETFL,0);
+	if ((flags < 0) || (0 != fcntl(fd,F_SETFL,flags | O_NONBLOCK)))
+		return false;
+	fd_ = fd;
+	name_ = name;
+	return true;
+	} // Attach
+
+void SerialIO::Close(void)
+	{
+	if (fd_ >= 0)
+		close(fd_);
+	fd_ = -1;
+	out_.clear();
+	readFull_ = false;
+	failed_   = false;
+	} // Close
+
+// read what is there, without waiting
+uint16 SerialIO::ReadBytes(uint8 * buffer, uint16 length)
+	{
+	readFull_ = false;
+	if ((fd_ < 0) || (0 == length))
+		return 0;
+	ssize_t count;
+	do
+		count = read(fd_,buffer,length);
+	while ((count < 0) && (EINTR == errno));
+	if ((count < 0) && (false == Transient(errno)))
+		failed_ = true;
+	if (count <= 0)
+		return 0;
+	bytesRead_ += count;
+	readFull_ = (count == length);
+	return static_cast<uint16>(count);
+	} // ReadBytes
+
+// send what the port takes, buffer the rest behind any already waiting
+void SerialIO::WriteBytes(const uint8 * buffer, uint16 length)
+	{
+	if (fd_ < 0)
+		return;
+	if (false == out_.empty())
+		{ // keep order
+		out_.insert(out_.end(),buffer,buffer+length);
+		Flush();
+		return;
+		}
+	ssize_t count;
+	do
+		count = write(fd_,buffer,length);
+	while ((count < 0) && (EINTR == errno));
+	if (count < 0)
+		{
+		if (false == Transient(errno))
+			failed_ = true;
+		count = 0;
+		}
+	bytesWritten_ += count;
+	if (count < length)
+		{
+		++writeStalls_;
+		out_.insert(out_.end(),buffer+count,buffer+length);
+		}
+	} // WriteBytes
+
+// send buffered bytes, return true if none are left
+bool SerialIO::Flush(void)
+	{
+	if ((fd_ < 0) || (true == out_.empty()))
+		return true;
+	ssize_t count;
+	do
+		count = write(fd_,&out_[0],out_.size());
+	while ((count < 0) && (EINTR == errno));
+	if ((count < 0) && (false == Transient(errno)))
+		failed_ = true;
+	if (count > 0)
+		{
+		bytesWritten_ += count;
+		out_.erase(out_.begin(),out_.begin()+count);
+		}
+	return out_.empty();
+	} // Flush
+
+}; // namespace HypnoGadget
+
+// end - SerialIO.cpp
@@ -0,0 +1,73 @@
+// HypnoCOMM - serial communications for the HypnoGadgets
+// www.HypnoCube.com, www.HypnoSquare.com
+// header for a POSIX serial port GadgetIO, for event loops
+#ifndef SERIALIO_H
+#define SERIALIO_H
+
+#include "Gadget.h"
+#include <string>
+#include <vector>
+
+namespace HypnoGadget {
+
+/* GadgetIO on a POSIX serial port opened non-blocking, so one thread can
+   service many ports from poll or epoll. Reads return what is there without
+   waiting. Writes send what the port takes and buffer the rest; call Flush
+   when the descriptor is writable to send more.
+*/
+class SerialIO : public GadgetIO
+	{
+public:
+	SerialIO(void);
+	~SerialIO(void);
+
+	// open a port such as /dev/ttyUSB0 at 38400 8N1, raw.
+	// return true on success, else false
+	bool Open(const std::string & portName);
+	void Close(void);
+
+	// descriptor for poll or epoll, -1 if closed
+	int Descriptor(void) const { return fd_; }
+	const std::string & Name(void) const { return name_; }
+
+	// GadgetIO
+	uint16 ReadBytes(uint8 * buffer, uint16 length);
+	void WriteBytes(const uint8 * buffer, uint16 length);
+
+	// send buffered bytes, return true if none are left
+	bool Flush(void);
+	bool Pending(void) const { return false == out_.empty(); }
+
+	// true if the last read filled the buffer, so more may be waiting
+	bool ReadFull(void) const { return readFull_; }
+
+	// true once a read or write failed for more than EAGAIN, such as a
+	// port unplugged or a pseudo terminal closed, until Close or Open
+	bool Failed(void) const { return failed_; }
+
+	// counts
+	uint64 BytesRead(void) const { return bytesRead_; }
+	uint64 BytesWritten(void) const { return bytesWritten_; }
+	uint32 WriteStalls(void) const { return writeStalls_; } // writes the port could not take at once
+
+	// open a descriptor not of a serial port, such as a pseudo terminal,
+	// taking ownership and making it non-blocking
+	bool Attach(int fd, const std::string & name);
+
+private:
+	int fd_;
+	std::string name_;
+	std::vector<uint8> out_; // bytes the port has not taken yet
+	bool readFull_;
+	bool failed_;
+	uint64 bytesRead_, bytesWritten_;
+	uint32 writeStalls_;
+
+	SerialIO(const SerialIO &);             // not copyable
+	SerialIO & operator=(const SerialIO &);
+	}; // class SerialIO
+
+}; // namespace HypnoGadget
+
+#endif // SERIALIO_H
+// end - SerialIO.h
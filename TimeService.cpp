@@ -0,0 +1,79 @@
+// HypnoCOMM - serial communications for the HypnoGadgets
+// www.HypnoCube.com, www.HypnoSquare.com
+// the clock time shown by clock faces
+#include "TimeService.h"
+#include "Timer.h"
+
+namespace HypnoGadget {
+
+namespace {
+const uint64 NanosPerSecond = 1000000000ULL;
+const uint64 AnchorSeconds  = 60; // how often to reread the wall clock
+	}; // anonymous namespace
+
+TimeService::TimeService(int updatesPerSec)
+	{
+	updatesPerSec_ = (updatesPerSec < 1) ? 1 : updatesPerSec;
+	valid_ = false;
+	Anchor();
+	} // TimeService
+
+// find the monotonic time of the current wall clock second
+void TimeService::Anchor(void)
+	{
+	// bracket the wall clock read so the two clocks are paired tightly
+	uint64 before = MonotonicNanos();
+	uint64 wall   = WallNanos();
+	uint64 after  = MonotonicNanos();
+	uint64 mono   = before + (after-before)/2;
+	anchorSecond_ = static_cast<time_t>(wall/NanosPerSecond);
+	anchorNanos_  = mono - wall%NanosPerSecond;
+	valid_ = false;
+	} // Anchor
+
+// fill calendar fields for the second at elapsed seconds past the anchor
+void TimeService::Fields(uint64 elapsed)
+	{
+	time_t t = anchorSecond_ + static_cast<time_t>(elapsed);
+	struct tm now;
+#ifdef WIN32
+	localtime_s(&now,&t);
+#else
+	localtime_r(&t,&now);
+#endif
+	time_.hour_   = now.tm_hour;
+	time_.minute_ = now.tm_min;
+	time_.second_ = now.tm_sec;
+	fieldSecond_  = elapsed;
+	valid_ = true;
+	} // Fields
+
+// the time now
+ClockTime TimeService::Now(void)
+	{
+	uint64 elapsed = MonotonicNanos() - anchorNanos_;
+	if (elapsed/NanosPerSecond >= AnchorSeconds)
+		{
+		Anchor();
+		elapsed = MonotonicNanos() - anchorNanos_;
+		}
+
+	uint64 second = elapsed/NanosPerSecond;
+	if ((false == valid_) || (second != fieldSecond_))
+		Fields(second);
+
+	ClockTime time = time_;
+	time.update_ = static_cast<int>((elapsed%NanosPerSecond)*updatesPerSec_/NanosPerSecond);
+	return time;
+	} // Now
+
+// MonotonicNanos of the next second edge
+uint64 TimeService::NextSecond(void)
+	{
+	uint64 elapsed = MonotonicNanos() - anchorNanos_;
+	return anchorNanos_ + (elapsed/NanosPerSecond + 1)*NanosPerSecond;
+	} // NextSecond
+
+}; // namespace HypnoGadget
+
+// end - TimeService.cpp
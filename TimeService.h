@@ -0,0 +1,50 @@
+// HypnoCOMM - serial communications for the HypnoGadgets
+// www.HypnoCube.com, www.HypnoSquare.com
+// header for the clock time shown by clock faces
+#ifndef TIMESERVICE_H
+#define TIMESERVICE_H
+
+#include "defines.h"
+#include "ClockRender.h"
+#include <ctime>
+
+namespace HypnoGadget {
+
+/* Gives the time of day for clock frames. The wall clock is read and
+   turned into calendar fields only when the second changes; in between
+   the monotonic clock counts from the edge of the current second, so the
+   update within the second is in phase with the real second and agrees
+   with the second hand. The wall clock is reread once a minute to follow
+   any setting of the system clock.
+*/
+class TimeService
+	{
+public:
+	TimeService(int updatesPerSec = 12);
+
+	// the time now. A copy, so every renderer of a frame sees the same time
+	ClockTime Now(void);
+
+	// MonotonicNanos of the next second edge, to start frame deadlines on
+	uint64 NextSecond(void);
+
+	int GetUpdatesPerSec(void) const { return updatesPerSec_; }
+
+private:
+	// find the monotonic time of the current wall clock second
+	void Anchor(void);
+	// fill calendar fields for the second at elapsed seconds past the anchor
+	void Fields(uint64 elapsed);
+
+	int updatesPerSec_;
+	time_t anchorSecond_; // wall clock second at the anchor
+	uint64 anchorNanos_;  // MonotonicNanos at the start of anchorSecond_
+	uint64 fieldSecond_;  // seconds past the anchor of the fields below
+	bool valid_;          // false until the fields are filled
+	ClockTime time_;      // fields, update_ filled in by Now
+	}; // class TimeService
+
+}; // namespace HypnoGadget
+
+#endif // TIMESERVICE_H
+// end - TimeService.h
@@ -0,0 +1,177 @@
+// HypnoCOMM - serial communications for the HypnoGadgets
+// www.HypnoCube.com, www.HypnoSquare.com
+// monotonic time and fixed rate frame scheduling
+#include "Timer.h"
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#include <errno.h>
+#endif
+
+namespace HypnoGadget {
+
+#ifdef WIN32
+// nanoseconds from the performance counter
+uint64 MonotonicNanos(void)
+	{
+	static LARGE_INTEGER frequency = {0};
+	if (0 == frequency.QuadPart)
+		QueryPerformanceFrequency(&frequency);
+	LARGE_INTEGER count;
+	QueryPerformanceCounter(&count);
+	// split to avoid overflow of count*1e9
+	uint64 seconds = count.QuadPart / frequency.QuadPart;
+	uint64 rest    = count.QuadPart % frequency.QuadPart;
+	return seconds*1000000000ULL + rest*1000000000ULL/frequency.QuadPart;
+	} // MonotonicNanos
+
+// nanoseconds since 1970 from the system time
+uint64 WallNanos(void)
+	{
+	FILETIME ft;
+	GetSystemTimeAsFileTime(&ft); // 100ns units since 1601
+	uint64 ticks = (static_cast<uint64>(ft.dwHighDateTime)<<32) | ft.dwLowDateTime;
+	return (ticks - 116444736000000000ULL)*100;
+	} // WallNanos
+
+// Win32 has no absolute sleep, so sleep whole milliseconds until done
+void SleepUntilNanos(uint64 deadline)
+	{
+	for (;;)
+		{
+		uint64 now = MonotonicNanos();
+		if (now >= deadline)
+			return;
+		DWORD ms = static_cast<DWORD>((deadline-now)/1000000);
+		Sleep(0 == ms ? 1 : ms);
+		}
+	} // SleepUntilNanos
+#else
+// nanoseconds from CLOCK_MONOTONIC
+uint64 MonotonicNanos(void)
+	{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return static_cast<uint64>(ts.tv_sec)*1000000000ULL + ts.tv_nsec;
+	} // MonotonicNanos
+
+// nanoseconds since 1970 from CLOCK_REALTIME
+uint64 WallNanos(void)
+	{
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME,&ts);
+	return static_cast<uint64>(ts.tv_sec)*1000000000ULL + ts.tv_nsec;
+	} // WallNanos
+
+// one absolute sleep, restarted if a signal interrupts it
+void SleepUntilNanos(uint64 deadline)
+	{
+	struct timespec ts;
+	ts.tv_sec  = static_cast<time_t>(deadline/1000000000ULL);
+	ts.tv_nsec = static_cast<long>(deadline%1000000000ULL);
+	while (EINTR == clock_nanosleep(CLOCK_MONOTONIC,TIMER_ABSTIME,&ts,0))
+		;
+	} // SleepUntilNanos
+#endif // WIN32
+
+FrameScheduler::FrameScheduler(uint32 rate) : lastLate_(0)
+	{
+	ClearStats();
+	Start(rate);
+	} // FrameScheduler
+
+// restart with the first deadline one period from now
+void FrameScheduler::Start(uint32 rate)
+	{
+	rate_  = (0 == rate) ? 1 : rate;
+	start_ = MonotonicNanos();
+	tick_  = 1;
+	} // Start
+
+// restart with the first deadline at start
+void FrameScheduler::Start(uint32 rate, uint64 start)
+	{
+	rate_  = (0 == rate) ? 1 : rate;
+	start_ = start;
+	tick_  = 0;
+	} // Start
+
+// change rate, keeping the next deadline
+void FrameScheduler::SetRate(uint32 rate)
+	{
+	if ((0 == rate) || (rate == rate_))
+		return;
+	start_ = Deadline();
+	tick_  = 0;
+	rate_  = rate;
+	} // SetRate
+
+// next deadline. Computed from the start each time so the period
+// rounding to nanoseconds never adds up, and rounded up so a tick never
+// wakes before its exact fraction of a second
+uint64 FrameScheduler::Deadline(void) const
+	{
+	return start_ + (tick_*1000000000ULL + rate_-1)/rate_;
+	} // Deadline
+
+// sleep until the next deadline, then move to the one after
+void FrameScheduler::Wait(void)
+	{
+	Wait(~0ULL);
+	} // Wait
+
+// sleep at most slice ns toward the next deadline
+bool FrameScheduler::Wait(uint64 slice)
+	{
+	uint64 deadline = Deadline();
+	uint64 now = MonotonicNanos();
+	if ((now < deadline) && (deadline - now > slice))
+		{ // not this time
+		if (0 != slice)
+			SleepUntilNanos(now + slice);
+		return false;
+		}
+	if (now < deadline)
+		{
+		SleepUntilNanos(deadline);
+		now = MonotonicNanos();
+		}
+	else
+		++stats_.overruns_;
+
+	uint64 late = now - deadline;
+	lastLate_ = late;
+	++stats_.ticks_;
+	stats_.lateSum_ += late;
+	if (late > stats_.lateMax_)
+		stats_.lateMax_ = late;
+
+	// next tick, dropping any that are already past
+	++tick_;
+	while (Deadline() <= now)
+		{
+		++tick_;
+		++stats_.skipped_;
+		}
+	return true;
+	} // Wait
+
+void FrameScheduler::GetStats(SchedulerStats & stats) const
+	{
+	stats = stats_;
+	} // GetStats
+
+void FrameScheduler::ClearStats(void)
+	{
+	stats_.ticks_    = 0;
+	stats_.overruns_ = 0;
+	stats_.skipped_  = 0;
+	stats_.lateMax_  = 0;
+	stats_.lateSum_  = 0;
+	} // ClearStats
+
+}; // namespace HypnoGadget
+
+// end - Timer.cpp
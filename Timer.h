@@ -0,0 +1,77 @@
+// HypnoCOMM - serial communications for the HypnoGadgets
+// www.HypnoCube.com, www.HypnoSquare.com
+// header for monotonic time and fixed rate frame scheduling
+#ifndef TIMER_H
+#define TIMER_H
+
+#include "defines.h"
+
+namespace HypnoGadget {
+
+// nanoseconds on a clock that never jumps, unrelated to the time of day
+uint64 MonotonicNanos(void);
+
+// nanoseconds since 1970 on the wall clock, which may be set at any time
+uint64 WallNanos(void);
+
+// sleep until MonotonicNanos reaches deadline
+void SleepUntilNanos(uint64 deadline);
+
+// statistics on how well a scheduler kept time
+struct SchedulerStats
+	{
+	uint32 ticks_;      // deadlines waited for
+	uint32 overruns_;   // deadlines already past when waited for
+	uint32 skipped_;    // whole periods dropped to catch up after overruns
+	uint64 lateMax_;    // worst wake up past a deadline, in ns
+	uint64 lateSum_;    // total wake up past deadlines, in ns, for the mean
+	};
+
+/* Wakes at a fixed rate. Deadline n is start + n periods, computed from
+   the start rather than from when the last wait finished, so lateness on
+   one tick does not push back the ones after it. If a deadline is missed by
+   more than a period the missed ticks are dropped rather than run back to
+   back. Sleeps on an absolute deadline, so there is no busy waiting.
+*/
+class FrameScheduler
+	{
+public:
+	FrameScheduler(uint32 rate = 12);
+
+	// restart with the first deadline one period from now
+	void Start(uint32 rate);
+	// restart with the first deadline at start, in MonotonicNanos
+	void Start(uint32 rate, uint64 start);
+
+	// change rate, keeping the next deadline
+	void SetRate(uint32 rate);
+	uint32 GetRate(void) const { return rate_; }
+
+	// next deadline, in MonotonicNanos
+	uint64 Deadline(void) const;
+
+	// sleep until the next deadline, then move to the one after
+	void Wait(void);
+	// sleep at most slice ns toward the next deadline, so the caller can
+	// work while waiting. True once the deadline is reached and passed.
+	// A slice of 0 never sleeps, for event loops with their own timeout
+	bool Wait(uint64 slice);
+
+	void GetStats(SchedulerStats & stats) const;
+	void ClearStats(void);
+
+	// how far past its deadline the last tick woke, in ns
+	uint64 LastLate(void) const { return lastLate_; }
+
+private:
+	uint32 rate_;   // ticks per second
+	uint64 start_;  // time of tick 0
+	uint64 tick_;   // next tick to wait for
+	uint64 lastLate_;
+	SchedulerStats stats_;
+	}; // class FrameScheduler
+
+}; // namespace HypnoGadget
+
+#endif // TIMER_H
+// end - Timer.h
@@ -0,0 +1,197 @@
+// HypnoCOMM - serial communications for the HypnoGadgets
+// www.HypnoCube.com, www.HypnoSquare.com
+// compile time tables for the HypnoCube voxel layout and clock hands
+#ifndef VOXELTABLES_H
+#define VOXELTABLES_H
+
+#include "defines.h"
+
+namespace HypnoGadget {
+
+/* Voxel layout. Coordinates i,j,k run 0-3. Frames pack two voxels in each
+   three bytes as R1G1 B1R2 G2B2, k planes 24 bytes apart, i columns 6 bytes
+   apart, and j reversed to get the right hand coord system used in the cube.
+   The wire index counts voxels in packed order, so its pair starts at byte
+   3*(index/2) and odd indices are the second voxel of the pair.
+*/
+
+// wire order index 0-63 of voxel i,j,k
+constexpr int VoxelIndex(int i, int j, int k)
+	{
+	return k*16 + i*4 + (3-j);
+	}
+
+// table index 0-63 of voxel i,j,k, for looking up VoxelSlots
+constexpr int VoxelTableIndex(int i, int j, int k)
+	{
+	return (i<<4) | (j<<2) | k;
+	}
+
+// where a voxel lives in a packed frame
+struct VoxelSlot
+	{
+	uint8 index_;  // wire order index 0-63
+	uint8 offset_; // first byte of the three holding its pair
+	uint8 odd_;    // 0 for R1G1 B1.., 1 for ..R2 G2B2
+	};
+
+constexpr VoxelSlot MakeVoxelSlot(int n)
+	{
+	return VoxelSlot {
+		static_cast<uint8>(VoxelIndex(n>>4,(n>>2)&3,n&3)),
+		static_cast<uint8>(3*(VoxelIndex(n>>4,(n>>2)&3,n&3)>>1)),
+		static_cast<uint8>(VoxelIndex(n>>4,(n>>2)&3,n&3)&1)
+		};
+	}
+
+#define VOXEL_SLOTS4(n)  MakeVoxelSlot(n), MakeVoxelSlot(n+1), MakeVoxelSlot(n+2), MakeVoxelSlot(n+3)
+#define VOXEL_SLOTS16(n) VOXEL_SLOTS4(n), VOXEL_SLOTS4(n+4), VOXEL_SLOTS4(n+8), VOXEL_SLOTS4(n+12)
+
+// slot of every voxel, indexed by VoxelTableIndex(i,j,k)
+constexpr VoxelSlot VoxelSlots[64] = {
+	VOXEL_SLOTS16(0), VOXEL_SLOTS16(16), VOXEL_SLOTS16(32), VOXEL_SLOTS16(48)
+	};
+
+#undef VOXEL_SLOTS16
+#undef VOXEL_SLOTS4
+
+/* Bitboards. A uint64 holds one bit per voxel in wire order, so each byte of
+   it is 8 voxels filling 12 bytes of a packed frame. For every byte value the
+   table gives those 12 bytes with each nibble 0xF where a voxel is lit, so a
+   byte of mask becomes a color by ANDing with the color's three byte pattern
+   R G, B R, G B repeated four times.
+*/
+
+// nibble mask of byte pos 0-11 of the 12 that the 8 voxels in bits fill
+constexpr uint8 BitboardByte(int bits, int pos)
+	{
+	return static_cast<uint8>(
+		(0 == pos%3) ? (((bits >> (2*(pos/3))) & 1) ? 0xFF : 0x00) :
+		(1 == pos%3) ? ((((bits >> (2*(pos/3))) & 1) ? 0xF0 : 0x00) |
+		                (((bits >> (2*(pos/3)+1)) & 1) ? 0x0F : 0x00)) :
+		               (((bits >> (2*(pos/3)+1)) & 1) ? 0xFF : 0x00));
+	}
+
+struct BitboardEntry
+	{
+	uint8 mask_[12];
+	};
+
+constexpr BitboardEntry MakeBitboardEntry(int bits)
+	{
+	return BitboardEntry {{
+		BitboardByte(bits,0), BitboardByte(bits,1), BitboardByte(bits,2),
+		BitboardByte(bits,3), BitboardByte(bits,4), BitboardByte(bits,5),
+		BitboardByte(bits,6), BitboardByte(bits,7), BitboardByte(bits,8),
+		BitboardByte(bits,9), BitboardByte(bits,10), BitboardByte(bits,11)
+		}};
+	}
+
+#define BITBOARD_ENTRIES4(n)  MakeBitboardEntry(n), MakeBitboardEntry(n+1), MakeBitboardEntry(n+2), MakeBitboardEntry(n+3)
+#define BITBOARD_ENTRIES16(n) BITBOARD_ENTRIES4(n), BITBOARD_ENTRIES4(n+4), BITBOARD_ENTRIES4(n+8), BITBOARD_ENTRIES4(n+12)
+#define BITBOARD_ENTRIES64(n) BITBOARD_ENTRIES16(n), BITBOARD_ENTRIES16(n+16), BITBOARD_ENTRIES16(n+32), BITBOARD_ENTRIES16(n+48)
+
+// frame bytes of every byte of a bitboard
+constexpr BitboardEntry BitboardBytes[256] = {
+	BITBOARD_ENTRIES64(0), BITBOARD_ENTRIES64(64), BITBOARD_ENTRIES64(128), BITBOARD_ENTRIES64(192)
+	};
+
+#undef BITBOARD_ENTRIES64
+#undef BITBOARD_ENTRIES16
+#undef BITBOARD_ENTRIES4
+
+/* Clock hands. The 12 positions of an analog clock, 0 being the 12 numeral.
+   Diagonal hands are vertical z-columns around the edge of the cube, turned
+   45 degrees so the back left corner (seen from the red power button side)
+   is 12, along with the nearest of the 4 middle z-columns. Plane hands are 4
+   leds in a vertical row plane, given as col plane and z plane, in the order
+   they light up between numerals. With the red power button on the left, col
+   planes run back to front and z planes bottom to top. There is no led in the
+   middle of the top row, so 12 uses the two leds nearest the center plus two
+   inboard of them. 12, 3, 6 and 9 are squares, the rest zigzags.
+*/
+
+struct DiagonalHand
+	{
+	uint8 row_, col_;   // z-column on the edge
+	uint8 mrow_, mcol_; // nearest middle z-column
+	};
+
+constexpr DiagonalHand DiagonalHands[12] = {
+	{0,0, 1,1}, {1,0, 1,1}, {2,0, 2,1}, {3,0, 2,1},
+	{3,1, 2,1}, {3,2, 2,2}, {3,3, 2,2}, {2,3, 2,2},
+	{1,3, 1,2}, {0,3, 1,2}, {0,2, 1,2}, {0,1, 1,1}
+	};
+
+struct PlaneLed
+	{
+	uint8 col_, z_;
+	};
+
+struct PlaneHand
+	{
+	PlaneLed led_[4];
+	};
+
+constexpr PlaneHand PlaneHands[12] = {
+	{{{1,3}, {2,3}, {2,2}, {1,2}}}, // 12 is a square, inside first, clockwise
+	{{{0,3}, {1,3}, {1,2}, {2,2}}},
+	{{{0,3}, {0,2}, {1,2}, {1,1}}},
+	{{{0,1}, {0,2}, {1,2}, {1,1}}},
+	{{{0,0}, {0,1}, {1,1}, {1,2}}},
+	{{{0,0}, {1,0}, {1,1}, {2,1}}},
+	{{{2,0}, {1,0}, {1,1}, {2,1}}},
+	{{{3,0}, {2,0}, {2,1}, {1,1}}},
+	{{{3,0}, {3,1}, {2,1}, {2,2}}},
+	{{{3,2}, {3,1}, {2,1}, {2,2}}},
+	{{{3,3}, {3,2}, {2,2}, {2,1}}},
+	{{{3,3}, {2,3}, {2,2}, {1,2}}}
+	};
+
+// compile time checks of the tables
+constexpr bool OnEdge(int row, int col)
+	{
+	return (0 == row) || (3 == row) || (0 == col) || (3 == col);
+	}
+constexpr bool InMiddle(int row, int col)
+	{
+	return (1 <= row) && (row <= 2) && (1 <= col) && (col <= 2);
+	}
+constexpr bool DiagonalHandsValid(int n)
+	{
+	return (n >= 12) || (OnEdge(DiagonalHands[n].row_,DiagonalHands[n].col_) &&
+		InMiddle(DiagonalHands[n].mrow_,DiagonalHands[n].mcol_) &&
+		DiagonalHandsValid(n+1));
+	}
+constexpr bool PlaneHandsValid(int n)
+	{
+	return (n >= 48) || ((PlaneHands[n/4].led_[n%4].col_ < 4) &&
+		(PlaneHands[n/4].led_[n%4].z_ < 4) && PlaneHandsValid(n+1));
+	}
+constexpr int Nibbles(int bits, int pos)
+	{
+	return (pos >= 12) ? 0 : (((BitboardBytes[bits].mask_[pos] >> 4) ? 1 : 0) +
+		((BitboardBytes[bits].mask_[pos] & 15) ? 1 : 0) + Nibbles(bits,pos+1));
+	}
+constexpr int BitCount(int bits)
+	{
+	return (0 == bits) ? 0 : (bits & 1) + BitCount(bits >> 1);
+	}
+constexpr bool BitboardBytesValid(int n)
+	{
+	return (n >= 256) || ((Nibbles(n,0) == 3*BitCount(n)) && BitboardBytesValid(n+1));
+	}
+constexpr bool VoxelSlotsValid(int n)
+	{
+	return (n >= 64) || ((VoxelSlots[n].offset_ + 2 < 96) &&
+		(VoxelSlots[n].offset_ == 3*(VoxelSlots[n].index_>>1)) && VoxelSlotsValid(n+1));
+	}
+static_assert(DiagonalHandsValid(0), "diagonal hand off the edge of the cube");
+static_assert(PlaneHandsValid(0),    "plane hand led outside the cube");
+static_assert(VoxelSlotsValid(0),    "voxel outside the frame");
+static_assert(BitboardBytesValid(0), "bitboard byte not 3 nibbles per voxel");
+
+}; // namespace HypnoGadget
+
+#endif // VOXELTABLES_H
+// end - VoxelTables.h
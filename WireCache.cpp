@@ -0,0 +1,169 @@
+// HypnoCOMM - serial communications for the HypnoGadgets
+// www.HypnoCube.com, www.HypnoSquare.com
+// cache of fully encoded SetFrame commands
+#include "WireCache.h"
+#include "Packet.h"
+#include "Command.h"
+#include <cstring>
+
+using namespace std;
+
+namespace HypnoGadget {
+
+namespace {
+
+// state used while packet code writes an encoded frame
+struct EncodeTarget
+	{
+	PacketHandlerState * state_;
+	WireFrame * wire_;
+	uint8 syncCount_;
+	};
+
+// collect bytes from the packet encoder, noting each packet CRC
+// as its closing SYNC is written
+void WriteWireByte(void * param, uint8 byte)
+	{
+	EncodeTarget * target = reinterpret_cast<EncodeTarget*>(param);
+	target->wire_->bytes_.push_back(byte);
+	if (PacketSYNC == byte)
+		{ // SYNC is never ESCaped, so every second one ends a packet
+		if ((target->syncCount_ & 1) && (target->syncCount_/2 < WirePacketCount))
+			target->wire_->crc_[target->syncCount_/2] = target->state_->packetEncodedCRC_;
+		++target->syncCount_;
+		}
+	} // WriteWireByte
+
+	}; // anonymous namespace
+
+// fast 64 bit hash of a block of bytes, eight bytes at a time
+uint64 FrameHash(const uint8 * data, uint16 length)
+	{
+	const uint64 prime = 0x9E3779B97F4A7C15ULL;
+	uint64 hash = 0xCBF29CE484222325ULL ^ length;
+	while (length >= 8)
+		{
+		uint64 word;
+		memcpy(&word,data,8);
+		hash = (hash ^ word) * prime;
+		hash ^= hash >> 29;
+		data += 8;
+		length -= 8;
+		}
+	while (length--)
+		hash = (hash ^ *data++) * prime;
+	// final mix so all bits depend on all input
+	hash ^= hash >> 32;
+	hash *= prime;
+	hash ^= hash >> 29;
+	return hash;
+	} // FrameHash
+
+WireCache::WireCache(uint32 size) : size_(size)
+	{
+	ClearStats();
+	} // WireCache
+
+// encode a SetFrame command for image into wire, without caching
+void WireCache::EncodeFrame(const uint8 * frame, WireFrame & wire)
+	{
+	memcpy(wire.frame_,frame,WireFrameSize);
+	EncodeBytes(frame,wire);
+	} // EncodeFrame
+
+// encode the packets straight from frame, leaving wire.frame_ alone
+void WireCache::EncodeBytes(const uint8 * frame, WireFrame & wire)
+	{
+	memset(wire.crc_,0,sizeof(wire.crc_));
+	wire.bytes_.clear();
+	// worst case, every byte ESCaped, plus the SYNCs
+	wire.bytes_.reserve(2*(1 + WireFrameSize + WirePacketCount*PacketOverhead) + 2*WirePacketCount);
+
+	PacketHandlerState state;
+	PacketReset(&state);
+	EncodeTarget target = {&state, &wire, 0};
+	PacketSendCommand(&state, WriteWireByte, &target, 0, CommandSetFrame, frame, WireFrameSize);
+	} // EncodeBytes
+
+// encode a SetFrame command once, to send to many gadgets
+SharedWireFrame WireCache::EncodeShared(const uint8 * frame)
+	{
+	shared_ptr<WireFrame> wire(new WireFrame);
+	EncodeBytes(frame,*wire);
+	return wire;
+	} // EncodeShared
+
+// return the encoding of a SetFrame command for this image, encoding
+// and storing it if not present. Reference valid until next call.
+const WireFrame & WireCache::Encode(const uint8 * frame)
+	{
+	if (0 == size_)
+		{ // cache disabled
+		++misses_;
+		EncodeFrame(frame,scratch_);
+		return scratch_;
+		}
+
+	uint64 hash = FrameHash(frame,WireFrameSize);
+	unordered_map<uint64,LruList::iterator>::iterator iter = index_.find(hash);
+	if (index_.end() != iter)
+		{
+		LruList::iterator item = iter->second;
+		if (0 == memcmp(item->second.frame_,frame,WireFrameSize))
+			{ // hit - move to front
+			++hits_;
+			lru_.splice(lru_.begin(),lru_,item);
+			return item->second;
+			}
+		// same hash, different image - replace the old one
+		++collisions_;
+		lru_.erase(item);
+		index_.erase(iter);
+		}
+
+	++misses_;
+	Trim(size_-1);
+	lru_.push_front(make_pair(hash,WireFrame()));
+	index_[hash] = lru_.begin();
+	EncodeFrame(frame,lru_.front().second);
+	return lru_.front().second;
+	} // Encode
+
+// drop oldest until at most size left
+void WireCache::Trim(uint32 size)
+	{
+	while (lru_.size() > size)
+		{
+		index_.erase(lru_.back().first);
+		lru_.pop_back();
+		++evictions_;
+		}
+	} // Trim
+
+// change the max number of frames held, dropping old ones if needed
+void WireCache::SetSize(uint32 size)
+	{
+	size_ = size;
+	Trim(size_);
+	} // SetSize
+
+// read statistics
+void WireCache::GetStats(WireCacheStats & stats) const
+	{
+	stats.hits_       = hits_;
+	stats.misses_     = misses_;
+	stats.evictions_  = evictions_;
+	stats.collisions_ = collisions_;
+	stats.count_      = static_cast<uint32>(lru_.size());
+	stats.size_       = size_;
+	} // GetStats
+
+// clear statistics
+void WireCache::ClearStats(void)
+	{
+	hits_ = misses_ = evictions_ = collisions_ = 0;
+	} // ClearStats
+
+}; // namespace HypnoGadget
+
+// end - WireCache.cpp
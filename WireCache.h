@@ -0,0 +1,90 @@
+// HypnoCOMM - serial communications for the HypnoGadgets
+// www.HypnoCube.com, www.HypnoSquare.com
+// header for a cache of fully encoded SetFrame commands
+#ifndef WIRECACHE_H
+#define WIRECACHE_H
+
+#include "defines.h"
+#include <list>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+
+namespace HypnoGadget {
+
+enum {
+	WireFrameSize    = 96, // bytes of image in a SetFrame command
+	WirePacketCount  = 2   // SetFrame command plus image takes this many packets
+	};
+
+// a SetFrame command exactly as it goes out the serial port
+struct WireFrame
+	{
+	uint8 frame_[WireFrameSize];   // the image this was encoded from
+	std::vector<uint8> bytes_;     // SYNC framed, ESCaped bytes of every packet
+	uint16 crc_[WirePacketCount];  // CRC of each packet, the last one is ACKed
+	};
+
+// an encoded frame shared by every gadget showing it, never changed once
+// made, so each gadget queues a reference instead of a copy of the bytes
+typedef std::shared_ptr<const WireFrame> SharedWireFrame;
+
+// counts to help size the cache
+struct WireCacheStats
+	{
+	uint32 hits_;       // frames sent from the cache
+	uint32 misses_;     // frames that had to be encoded
+	uint32 evictions_;  // old frames dropped to make room
+	uint32 collisions_; // hash matched but image did not
+	uint32 count_;      // frames held now
+	uint32 size_;       // max frames held
+	};
+
+// fast 64 bit hash of a block of bytes
+uint64 FrameHash(const uint8 * data, uint16 length);
+
+/* Least recently used cache of encoded SetFrame commands, keyed by a hash of
+   the image. A clock face shows a limited set of images, so most frames can go
+   out as a single copy of bytes instead of redoing CRC, packets and ESCapes.
+   Images are compared on a hash match, so a collision only costs an encode.
+*/
+class WireCache
+	{
+public:
+	// size is the max number of frames held, 0 disables the cache
+	WireCache(uint32 size = 64);
+
+	// return the encoding of a SetFrame command for this image, encoding
+	// and storing it if not present. Reference valid until next call.
+	const WireFrame & Encode(const uint8 * frame);
+
+	// change the max number of frames held, dropping old ones if needed
+	void SetSize(uint32 size);
+
+	// read and optionally clear statistics
+	void GetStats(WireCacheStats & stats) const;
+	void ClearStats(void);
+
+	// encode a SetFrame command for image into wire, without caching
+	static void EncodeFrame(const uint8 * frame, WireFrame & wire);
+
+	// encode a SetFrame command once, to send to many gadgets. The packets
+	// are made straight from frame, which is not kept in frame_
+	static SharedWireFrame EncodeShared(const uint8 * frame);
+
+private:
+	typedef std::list<std::pair<uint64,WireFrame> > LruList; // most recent first
+	LruList lru_;
+	std::unordered_map<uint64,LruList::iterator> index_;
+	WireFrame scratch_; // used when cache is disabled
+	uint32 size_;
+	uint32 hits_, misses_, evictions_, collisions_;
+
+	void Trim(uint32 size); // drop oldest until at most size left
+	static void EncodeBytes(const uint8 * frame, WireFrame & wire); // packets only
+	}; // class WireCache
+
+}; // namespace HypnoGadget
+
+#endif // WIRECACHE_H
+// end - WireCache.h
@@ -0,0 +1,214 @@
+// HypnoCOMM - serial communications for the HypnoGadgets
+// www.HypnoCube.com, www.HypnoSquare.com
+// capturing the bytes to and from a gadget, and reading them back
+#include "WireRecorder.h"
+#include "Timer.h"
+#include <chrono>
+
+using namespace std;
+
+namespace HypnoGadget {
+
+namespace {
+
+const uint8 CaptureMagic[4] = {'H','Y','P','W'};
+
+void PutVarint(vector<uint8> & out, uint64 value)
+	{
+	while (value >= 0x80)
+		{
+		out.push_back(static_cast<uint8>(value | 0x80));
+		value >>= 7;
+		}
+	out.push_back(static_cast<uint8>(value));
+	} // PutVarint
+
+	}; // anonymous namespace
+
+WireRecorder::WireRecorder(void) : file_(0), start_(0), last_(0), records_(0), dropped_(0), stopping_(false)
+	{
+	} // WireRecorder
+
+WireRecorder::~WireRecorder(void)
+	{
+	Stop();
+	} // ~WireRecorder
+
+// start a capture file, replacing any
+bool WireRecorder::Start(const string & path)
+	{
+	Stop();
+	FILE * file = fopen(path.c_str(),"wb");
+	if (0 == file)
+		return false;
+
+	start_ = last_ = MonotonicNanos();
+	uint8 header[16] = {
+		CaptureMagic[0], CaptureMagic[1], CaptureMagic[2], CaptureMagic[3],
+		static_cast<uint8>(FormatVersion), static_cast<uint8>(FormatVersion >> 8), 0, 0
+		};
+	for (int pos = 0; pos < 8; ++pos)
+		header[8+pos] = static_cast<uint8>(start_ >> (8*pos));
+	if (sizeof(header) != fwrite(header,1,sizeof(header),file))
+		{
+		fclose(file);
+		return false;
+		}
+
+	file_ = file;
+	records_ = dropped_ = 0;
+	buffer_.clear();
+	buffer_.reserve(BufferBytes + 1024);
+	stopping_ = false;
+	writer_ = thread(&WireRecorder::Writer,this);
+	return true;
+	} // Start
+
+// write what is buffered and close the file
+void WireRecorder::Stop(void)
+	{
+	if (0 == file_)
+		return;
+	unique_lock<mutex> guard(lock_);
+	Hand();
+	stopping_ = true;
+	ready_.notify_one();
+	guard.unlock();
+	writer_.join();
+	fclose(file_);
+	file_ = 0;
+	} // Stop
+
+// add a record, only to memory
+void WireRecorder::Record(WireDirection direction, const uint8 * bytes, uint16 length, uint64 now)
+	{
+	if ((0 == file_) || (0 == length))
+		return;
+	lock_guard<mutex> guard(lock_);
+	if (full_.size() >= MaxBuffered)
+		{ // the disk is far behind, drop rather than stall
+		++dropped_;
+		return;
+		}
+	// keep time whole across dropped records by measuring from the last kept one
+	uint64 delta = (now > last_) ? now - last_ : 0;
+	last_ += delta;
+	buffer_.push_back(static_cast<uint8>(direction));
+	PutVarint(buffer_,delta);
+	PutVarint(buffer_,length);
+	buffer_.insert(buffer_.end(),bytes,bytes+length);
+	++records_;
+	if (buffer_.size() >= BufferBytes)
+		Hand();
+	} // Record
+
+// buffer_ to the writer, lock held
+void WireRecorder::Hand(void)
+	{
+	if (true == buffer_.empty())
+		return;
+	full_.push_back(vector<uint8>());
+	full_.back().swap(buffer_);
+	buffer_.reserve(BufferBytes + 1024);
+	ready_.notify_one();
+	} // Hand
+
+// write buffers as they fill, and every so often what has come so far
+void WireRecorder::Writer(void)
+	{
+	unique_lock<mutex> guard(lock_);
+	for (;;)
+		{
+		if ((true == full_.empty()) && (false == stopping_))
+			{
+			ready_.wait_for(guard,chrono::milliseconds(250));
+			if (true == full_.empty())
+				Hand(); // a quiet link still reaches the disk
+			}
+		if ((true == full_.empty()) && (true == stopping_))
+			break;
+		vector<vector<uint8> > writing;
+		writing.swap(full_);
+		guard.unlock();
+		for (size_t pos = 0; pos < writing.size(); ++pos)
+			fwrite(&writing[pos][0],1,writing[pos].size(),file_);
+		fflush(file_);
+		guard.lock();
+		}
+	} // Writer
+
+WireCapture::WireCapture(void) : file_(0), start_(0), nanos_(0)
+	{
+	} // WireCapture
+
+WireCapture::~WireCapture(void)
+	{
+	Close();
+	} // ~WireCapture
+
+bool WireCapture::Open(const string & path)
+	{
+	Close();
+	file_ = fopen(path.c_str(),"rb");
+	if (0 == file_)
+		return false;
+	uint8 header[16];
+	if ((sizeof(header) != fread(header,1,sizeof(header),file_)) ||
+		(CaptureMagic[0] != header[0]) || (CaptureMagic[1] != header[1]) ||
+		(CaptureMagic[2] != header[2]) || (CaptureMagic[3] != header[3]) ||
+		(WireRecorder::FormatVersion != (header[4] | (header[5] << 8))))
+		{
+		Close();
+		return false;
+		}
+	start_ = 0;
+	for (int pos = 0; pos < 8; ++pos)
+		start_ |= static_cast<uint64>(header[8+pos]) << (8*pos);
+	nanos_ = 0;
+	return true;
+	} // Open
+
+void WireCapture::Close(void)
+	{
+	if (0 != file_)
+		fclose(file_);
+	file_ = 0;
+	} // Close
+
+bool WireCapture::ReadVarint(uint64 & value)
+	{
+	value = 0;
+	for (int shift = 0; shift < 64; shift += 7)
+		{
+		int byte = fgetc(file_);
+		if (EOF == byte)
+			return false;
+		value |= static_cast<uint64>(byte & 0x7F) << shift;
+		if (0 == (byte & 0x80))
+			return true;
+		}
+	return false;
+	} // ReadVarint
+
+// next record, false at the end or on a damaged record
+bool WireCapture::Next(WireRecord & record)
+	{
+	if (0 == file_)
+		return false;
+	int direction = fgetc(file_);
+	uint64 delta, length;
+	if ((EOF == direction) || (WireOut < direction) ||
+		(false == ReadVarint(delta)) || (false == ReadVarint(length)) || (length > 65535))
+		return false;
+	record.bytes_.resize(static_cast<size_t>(length));
+	if ((0 != length) && (length != fread(&record.bytes_[0],1,static_cast<size_t>(length),file_)))
+		return false;
+	nanos_ += delta;
+	record.direction_ = static_cast<WireDirection>(direction);
+	record.nanos_     = nanos_;
+	return true;
+	} // Next
+
+}; // namespace HypnoGadget
+
+// end - WireRecorder.cpp
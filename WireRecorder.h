@@ -0,0 +1,115 @@
+// HypnoCOMM - serial communications for the HypnoGadgets
+// www.HypnoCube.com, www.HypnoSquare.com
+// header for capturing the bytes to and from a gadget, and reading them back
+#ifndef WIRERECORDER_H
+#define WIRERECORDER_H
+
+#include "defines.h"
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace HypnoGadget {
+
+/* Capture file layout, little endian:
+       "HYPW", version (2 bytes), 2 bytes 0, start MonotonicNanos (8 bytes)
+   then one record per read or write:
+       direction byte, time since the last record in ns, length, bytes
+   with the time and length as 7 bits per byte varints, low bits first.
+   Records are usually a few bytes of header on the bytes themselves.
+*/
+
+enum WireDirection {
+	WireIn  = 0, // read from the gadget
+	WireOut = 1  // written to the gadget
+	};
+
+// one read or write
+struct WireRecord
+	{
+	WireDirection direction_;
+	uint64 nanos_;             // since the capture started
+	std::vector<uint8> bytes_;
+	};
+
+/* Records every byte in and out of a gadget. Record only appends to a
+   memory buffer; a background thread writes full buffers to the file. If
+   the disk falls far behind, records are dropped and counted rather than
+   stalling the caller.
+*/
+class WireRecorder
+	{
+public:
+	enum {
+		FormatVersion = 1,
+		BufferBytes   = 65536,   // hand a buffer to the writer at this size
+		MaxBuffered   = 64       // buffers waiting before records are dropped
+		};
+
+	WireRecorder(void);
+	~WireRecorder(void);
+
+	// start a capture file, replacing any. Return false if it will not open
+	bool Start(const std::string & path);
+	// write what is buffered and close the file
+	void Stop(void);
+	bool Recording(void) const { return 0 != file_; }
+
+	// add a record, now is MonotonicNanos
+	void Record(WireDirection direction, const uint8 * bytes, uint16 length, uint64 now);
+
+	uint64 Records(void) const { return records_; }
+	uint64 Dropped(void) const { return dropped_; }
+
+private:
+	FILE * file_;
+	uint64 start_, last_;    // MonotonicNanos of the capture start and last record
+	uint64 records_, dropped_;
+
+	std::vector<uint8> buffer_;               // being filled
+	std::vector<std::vector<uint8> > full_;   // waiting for the writer
+	std::mutex lock_;
+	std::condition_variable ready_;
+	std::thread writer_;
+	bool stopping_;
+
+	void Writer(void);      // thread body
+	void Hand(void);        // buffer_ to the writer, lock held
+
+	WireRecorder(const WireRecorder &);             // not copyable
+	WireRecorder & operator=(const WireRecorder &);
+	}; // class WireRecorder
+
+// reads a capture back, one record at a time
+class WireCapture
+	{
+public:
+	WireCapture(void);
+	~WireCapture(void);
+
+	// return false if the file will not open or is not a capture
+	bool Open(const std::string & path);
+	void Close(void);
+
+	// next record, false at the end or on a damaged record
+	bool Next(WireRecord & record);
+
+	uint64 Start(void) const { return start_; } // MonotonicNanos at capture start
+
+private:
+	FILE * file_;
+	uint64 start_, nanos_;
+
+	bool ReadVarint(uint64 & value);
+
+	WireCapture(const WireCapture &);             // not copyable
+	WireCapture & operator=(const WireCapture &);
+	}; // class WireCapture
+
+}; // namespace HypnoGadget
+
+#endif // WIRERECORDER_H
+// end - WireRecorder.h
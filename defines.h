@@ -9,7 +9,12 @@
 namespace HypnoGadget {
 #endif // WIN32
 
+typedef unsigned long long uint64;
+#if defined(_LP64) || defined(__LP64__)
+typedef unsigned int   uint32; // long is 64 bits here
+#else
 typedef unsigned long  uint32;
+#endif
 typedef unsigned short uint16;
 typedef unsigned char  uint8;
 